@@ -0,0 +1,520 @@
+#include "block_reader.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/log/trivial.hpp>
+#include <poll.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "exception_helpers.hpp"
+
+namespace pcap {
+
+namespace {
+
+constexpr int kPollTimeoutMs = 100;
+
+bool IsSeekable(int fd) {
+  struct stat st;
+  return fstat(fd, &st) == 0 && (S_ISREG(st.st_mode) || S_ISBLK(st.st_mode));
+}
+
+class ReadAheadThreadReader : public BlockReader {
+ public:
+  ReadAheadThreadReader(int fd, size_t block_size, size_t blocks_count)
+      : fd_(fd), seekable_(IsSeekable(fd)), buffers_(blocks_count, std::vector<uint8_t>(block_size)) {
+    for (size_t i = 0; i < blocks_count; i++) {
+      free_.push_back(i);
+    }
+    reader_ = std::thread([this] { ReadLoop(); });
+  }
+
+  ~ReadAheadThreadReader() override {
+    {
+      std::lock_guard lock(mutex_);
+      stopped_ = true;
+    }
+    buffer_freed_.notify_one();
+    reader_.join();
+  }
+
+  Block Acquire() override {
+    std::unique_lock lock(mutex_);
+    buffer_filled_.wait(lock, [this] { return !filled_.empty() || finished_; });
+    if (filled_.empty()) {
+      if (error_) {
+        std::rethrow_exception(error_);
+      }
+      return Block{nullptr, 0, 0};
+    }
+    auto block = filled_.front();
+    filled_.pop_front();
+    return block;
+  }
+
+  void Release(const Block& block) override {
+    if (block.size == 0) {
+      return;
+    }
+    {
+      std::lock_guard lock(mutex_);
+      free_.push_back(block.id);
+    }
+    buffer_freed_.notify_one();
+  }
+
+ private:
+  void ReadLoop() {
+    try {
+      while (true) {
+        size_t id;
+        {
+          std::unique_lock lock(mutex_);
+          buffer_freed_.wait(lock, [this] { return !free_.empty() || stopped_; });
+          if (stopped_) {
+            break;
+          }
+          id = free_.front();
+          free_.pop_front();
+        }
+
+        const auto size = Fill(buffers_[id]);
+        {
+          std::lock_guard lock(mutex_);
+          if (size != 0) {
+            filled_.push_back(Block{buffers_[id].data(), size, id});
+          }
+        }
+        buffer_filled_.notify_one();
+        if (size < buffers_[id].size()) {
+          break;
+        }
+      }
+    } catch (...) {
+      std::lock_guard lock(mutex_);
+      error_ = std::current_exception();
+    }
+    {
+      std::lock_guard lock(mutex_);
+      finished_ = true;
+    }
+    buffer_filled_.notify_one();
+  }
+
+  // Reads until the buffer is full, the input ends or the reader is stopped
+  size_t Fill(std::vector<uint8_t>& buffer) {
+    size_t filled = 0;
+    while (filled < buffer.size() && WaitReadable()) {
+      const auto result = read(fd_, buffer.data() + filled, buffer.size() - filled);
+      if (result < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        util::throw_runtime_exception("Failed to read input: ", std::strerror(errno));
+      }
+      if (result == 0) {
+        break;
+      }
+      filled += result;
+    }
+    return filled;
+  }
+
+  // Pipes may block forever, so they are polled to notice the reader being stopped
+  bool WaitReadable() {
+    if (seekable_) {
+      return !stopped_;
+    }
+    pollfd descriptor{.fd = fd_, .events = POLLIN, .revents = 0};
+    while (!stopped_) {
+      if (poll(&descriptor, 1, kPollTimeoutMs) != 0) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const int fd_;
+  const bool seekable_;
+  std::vector<std::vector<uint8_t>> buffers_;
+
+  std::mutex mutex_;
+  std::condition_variable buffer_filled_;
+  std::condition_variable buffer_freed_;
+  std::deque<size_t> free_;
+  std::deque<Block> filled_;
+  bool finished_ = false;
+  std::atomic<bool> stopped_ = false;
+  std::exception_ptr error_;
+
+  std::thread reader_;
+};
+
+#ifdef HAVE_IO_URING
+
+constexpr uint64_t kCancelUserData = std::numeric_limits<uint64_t>::max();
+
+// Minimal io_uring submission/completion queue pair driven by raw syscalls
+class Ring {
+ public:
+  explicit Ring(unsigned entries) {
+    try {
+      Init(entries);
+    } catch (...) {
+      Close();
+      throw;
+    }
+  }
+
+  ~Ring() {
+    Close();
+  }
+
+  Ring(const Ring&) = delete;
+  Ring& operator=(const Ring&) = delete;
+
+  void Submit(const io_uring_sqe& sqe) {
+    const unsigned tail = *sq_tail_;
+    const unsigned index = tail & *sq_mask_;
+    sqes_[index] = sqe;
+    sq_array_[index] = index;
+    std::atomic_ref(*sq_tail_).store(tail + 1, std::memory_order_release);
+    Enter(1, 0, 0);
+  }
+
+  // Waits for at least one completion and invokes handler(user_data, result) for each
+  template<class Handler>
+  void Reap(Handler&& handler) {
+    unsigned head = *cq_head_;
+    while (head == std::atomic_ref(*cq_tail_).load(std::memory_order_acquire)) {
+      Enter(0, 1, IORING_ENTER_GETEVENTS);
+    }
+    const unsigned tail = std::atomic_ref(*cq_tail_).load(std::memory_order_acquire);
+    for (; head != tail; head++) {
+      const auto cqe = cqes_[head & *cq_mask_];
+      std::atomic_ref(*cq_head_).store(head + 1, std::memory_order_release);
+      handler(cqe.user_data, cqe.res);
+    }
+  }
+
+ private:
+  void Init(unsigned entries) {
+    io_uring_params params{};
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) {
+      util::throw_runtime_exception("io_uring_setup failed: ", std::strerror(errno));
+    }
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    }
+    sq_ring_ = Map(sq_ring_size_, IORING_OFF_SQ_RING);
+    cq_ring_ = single_mmap ? sq_ring_ : Map(cq_ring_size_, IORING_OFF_CQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(Map(sqes_size_, IORING_OFF_SQES));
+
+    auto sq_ring = static_cast<uint8_t*>(sq_ring_);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+    sq_mask_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+    auto cq_ring = static_cast<uint8_t*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+
+    CheckReadSupported();
+  }
+
+  void CheckReadSupported() {
+    constexpr unsigned kProbeOps = 256;
+    std::vector<uint8_t> storage(sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op));
+    auto probe = reinterpret_cast<io_uring_probe*>(storage.data());
+    if (syscall(__NR_io_uring_register, fd_, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) {
+      util::throw_runtime_exception("io_uring probe failed: ", std::strerror(errno));
+    }
+    if (probe->last_op < IORING_OP_READ ||
+        !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)) {
+      util::throw_runtime_exception("io_uring does not support reads");
+    }
+  }
+
+  void* Map(size_t size, off_t offset) {
+    auto result = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, offset);
+    if (result == MAP_FAILED) {
+      util::throw_runtime_exception("Failed to map io_uring: ", std::strerror(errno));
+    }
+    return result;
+  }
+
+  void Enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    while (syscall(__NR_io_uring_enter, fd_, to_submit, min_complete, flags, nullptr, 0) < 0) {
+      if (errno != EINTR) {
+        util::throw_runtime_exception("io_uring_enter failed: ", std::strerror(errno));
+      }
+    }
+  }
+
+  void Close() {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  int fd_ = -1;
+  void* sq_ring_ = MAP_FAILED;
+  size_t sq_ring_size_ = 0;
+  void* cq_ring_ = MAP_FAILED;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+  size_t sqes_size_ = 0;
+
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+};
+
+// Regular files get a read in flight for every free buffer, each at its own
+// offset. Pipes cannot be read at an offset, so there the buffers are filled
+// one after another, which still overlaps reading with decoding.
+class IoUringReader : public BlockReader {
+ public:
+  IoUringReader(int fd, size_t block_size, size_t blocks_count)
+      : fd_(fd),
+        seekable_(IsSeekable(fd)),
+        block_size_(block_size),
+        slots_(blocks_count),
+        ring_(std::bit_ceil(2 * blocks_count)) {
+    try {
+      for (size_t id = 0; id < slots_.size(); id++) {
+        slots_[id].buffer.resize(block_size_);
+        Enqueue(id);
+      }
+    } catch (...) {
+      Drain();
+      throw;
+    }
+  }
+
+  ~IoUringReader() override {
+    try {
+      Drain();
+    } catch (...) {
+      // Nothing sensible is left to do with the failure while being destroyed
+    }
+  }
+
+  Block Acquire() override {
+    if (exhausted_ || queue_.empty()) {
+      return Block{nullptr, 0, 0};
+    }
+    const auto id = queue_.front();
+    while (!slots_[id].complete) {
+      ring_.Reap([this](uint64_t user_data, int result) {
+        if (user_data != kCancelUserData) {
+          OnCompletion(user_data, result);
+        }
+      });
+    }
+    queue_.pop_front();
+    if (slots_[id].filled == 0) {
+      exhausted_ = true;
+      return Block{nullptr, 0, 0};
+    }
+    return Block{slots_[id].buffer.data(), slots_[id].filled, id};
+  }
+
+  void Release(const Block& block) override {
+    if (block.size != 0) {
+      Enqueue(block.id);
+    }
+  }
+
+ private:
+  struct Slot {
+    std::vector<uint8_t> buffer;
+    uint64_t offset = 0;
+    size_t filled = 0;
+    bool complete = false;
+    bool in_flight = false;
+  };
+
+  void Enqueue(size_t id) {
+    auto& slot = slots_[id];
+    slot.offset = next_offset_;
+    slot.filled = 0;
+    slot.complete = eof_;
+    next_offset_ += block_size_;
+    queue_.push_back(id);
+    if (eof_) {
+      return;
+    }
+    if (seekable_) {
+      SubmitRead(id);
+    } else {
+      SubmitNextStreamRead();
+    }
+  }
+
+  void SubmitRead(size_t id) {
+    auto& slot = slots_[id];
+    io_uring_sqe sqe{};
+    sqe.opcode = IORING_OP_READ;
+    sqe.fd = fd_;
+    sqe.addr = reinterpret_cast<uint64_t>(slot.buffer.data() + slot.filled);
+    sqe.len = static_cast<uint32_t>(block_size_ - slot.filled);
+    sqe.off = seekable_ ? slot.offset + slot.filled : std::numeric_limits<uint64_t>::max();
+    sqe.user_data = id;
+    ring_.Submit(sqe);
+    slot.in_flight = true;
+    in_flight_++;
+  }
+
+  void SubmitNextStreamRead() {
+    if (eof_ || in_flight_ != 0) {
+      return;
+    }
+    for (auto id : queue_) {
+      if (!slots_[id].complete) {
+        SubmitRead(id);
+        return;
+      }
+    }
+  }
+
+  void OnCompletion(size_t id, int result) {
+    auto& slot = slots_[id];
+    slot.in_flight = false;
+    in_flight_--;
+
+    if (result == -EINTR || result == -EAGAIN) {
+      SubmitRead(id);
+      return;
+    }
+    if (result < 0) {
+      util::throw_runtime_exception("Failed to read input: ", std::strerror(-result));
+    }
+    if (result == 0) {
+      slot.complete = true;
+      MarkEof();
+      return;
+    }
+
+    slot.filled += result;
+    if (slot.filled < block_size_) {
+      SubmitRead(id);
+      return;
+    }
+    slot.complete = true;
+    if (!seekable_) {
+      SubmitNextStreamRead();
+    }
+  }
+
+  void MarkEof() {
+    eof_ = true;
+    // Reads past the end of a regular file complete by themselves, while
+    // stream buffers waiting for their turn will never be read
+    for (auto id : queue_) {
+      if (!slots_[id].in_flight) {
+        slots_[id].complete = true;
+      }
+    }
+  }
+
+  // Waits for the kernel to stop using the buffers
+  void Drain() {
+    for (size_t id = 0; id < slots_.size(); id++) {
+      if (slots_[id].in_flight) {
+        io_uring_sqe sqe{};
+        sqe.opcode = IORING_OP_ASYNC_CANCEL;
+        sqe.addr = id;
+        sqe.user_data = kCancelUserData;
+        ring_.Submit(sqe);
+      }
+    }
+    while (in_flight_ != 0) {
+      ring_.Reap([this](uint64_t user_data, int) {
+        if (user_data != kCancelUserData) {
+          slots_[user_data].in_flight = false;
+          in_flight_--;
+        }
+      });
+    }
+  }
+
+  const int fd_;
+  const bool seekable_;
+  const size_t block_size_;
+  std::vector<Slot> slots_;
+  Ring ring_;
+
+  std::deque<size_t> queue_;  // slots in the order of the input
+  uint64_t next_offset_ = 0;
+  size_t in_flight_ = 0;
+  bool eof_ = false;
+  bool exhausted_ = false;
+};
+
+#endif  // HAVE_IO_URING
+
+}  // namespace
+
+std::unique_ptr<BlockReader> MakeBlockReader(
+    int fd,
+    size_t block_size,
+    size_t blocks_count,
+    BlockReader::Backend backend) {
+  if (block_size == 0 || blocks_count == 0) {
+    util::throw_runtime_exception("Block reader needs at least one non-empty block");
+  }
+
+  if (backend == BlockReader::Backend::IoUring) {
+#ifdef HAVE_IO_URING
+    try {
+      return std::make_unique<IoUringReader>(fd, block_size, blocks_count);
+    } catch (const std::runtime_error& exc) {
+      BOOST_LOG_TRIVIAL(warning) << "io_uring is unavailable, reading ahead on a thread instead: " << exc.what();
+    }
+#else
+    BOOST_LOG_TRIVIAL(warning) << "Built without io_uring, reading ahead on a thread instead";
+#endif
+  }
+  return std::make_unique<ReadAheadThreadReader>(fd, block_size, blocks_count);
+}
+
+}  // namespace pcap
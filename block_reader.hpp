@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+namespace pcap {
+
+struct Block {
+  const uint8_t* data;
+  size_t size;  // zero once the input is exhausted
+  size_t id;
+};
+
+// Reads a file descriptor sequentially into a fixed set of buffers which are
+// kept in flight ahead of the consumer.
+class BlockReader {
+ public:
+  enum class Backend {
+    IoUring,  // falls back to ReadAheadThread when io_uring is not available
+    ReadAheadThread,
+  };
+
+  virtual ~BlockReader() = default;
+
+  // Blocks until the next block of the input is read
+  virtual Block Acquire() = 0;
+
+  // Hands the buffer of an acquired block back for reading further data
+  virtual void Release(const Block& block) = 0;
+};
+
+std::unique_ptr<BlockReader> MakeBlockReader(
+  int fd,
+  size_t block_size,
+  size_t blocks_count,
+  BlockReader::Backend backend);
+
+}  // namespace pcap
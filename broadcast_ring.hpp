@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "exception_helpers.hpp"
+#include "wait_strategy.hpp"
+
+namespace util {
+
+struct ConsumerStats {
+  uint64_t consumed;  // messages handled by the consumer
+  uint64_t lag;       // messages published but not yet handled
+  uint64_t max_lag;   // largest lag the consumer has seen when catching up
+};
+
+// Disruptor-style ring: one producer publishes every message once into a
+// preallocated slot, and a fixed set of consumers read all messages in
+// place, each at its own pace. The producer waits only when the slowest
+// consumer is a full ring behind.
+template<class T>
+class BroadcastRing {
+ public:
+  BroadcastRing(size_t capacity, size_t consumers_count, WaitStrategy wait_strategy)
+      : slots_(std::bit_ceil(capacity)),
+        mask_(slots_.size() - 1),
+        consumers_(consumers_count),
+        wait_strategy_(wait_strategy) {
+    if (consumers_count == 0) {
+      throw_runtime_exception("Broadcast ring needs at least one consumer");
+    }
+  }
+
+  BroadcastRing(const BroadcastRing&) = delete;
+  BroadcastRing& operator=(const BroadcastRing&) = delete;
+
+  // Called by the producer; fill(T&) writes the message into its slot
+  template<class Fill>
+  void Publish(Fill&& fill) {
+    const auto sequence = next_sequence_;
+    if (sequence - gating_sequence_ >= slots_.size()) {
+      gating_sequence_ = WaitForConsumers(sequence + 1 - slots_.size());
+    }
+    fill(slots_[sequence & mask_]);
+    next_sequence_ = sequence + 1;
+    published_.store(next_sequence_, std::memory_order_release);
+    if (wait_strategy_ == WaitStrategy::Block) {
+      published_.notify_all();
+    }
+  }
+
+  // Called by the producer; consumers return once they handle all published messages
+  void Close() {
+    published_.store(next_sequence_ | kClosedBit, std::memory_order_release);
+    published_.notify_all();
+  }
+
+  // Runs on the consumer's thread and invokes handler(const T&) for every
+  // message until the ring is closed
+  template<class Handler>
+  void Consume(size_t consumer_index, Handler&& handler) {
+    auto& consumer = consumers_[consumer_index];
+    uint64_t next = consumer.consumed.load(std::memory_order_relaxed);
+    while (true) {
+      const auto published = WaitForPublished(next);
+      const auto available = published & ~kClosedBit;
+      if (next == available) {
+        return;  // closed and drained
+      }
+
+      if (available - next > consumer.max_lag.load(std::memory_order_relaxed)) {
+        consumer.max_lag.store(available - next, std::memory_order_relaxed);
+      }
+      for (; next < available; next++) {
+        handler(static_cast<const T&>(slots_[next & mask_]));
+      }
+      consumer.consumed.store(next, std::memory_order_release);
+      if (wait_strategy_ == WaitStrategy::Block) {
+        consumer.consumed.notify_one();
+      }
+    }
+  }
+
+  ConsumerStats Stats(size_t consumer_index) const {
+    const auto& consumer = consumers_[consumer_index];
+    const auto consumed = consumer.consumed.load(std::memory_order_acquire);
+    const auto published = published_.load(std::memory_order_acquire) & ~kClosedBit;
+    return ConsumerStats{
+      .consumed = consumed,
+      .lag = published - consumed,
+      .max_lag = consumer.max_lag.load(std::memory_order_relaxed)
+    };
+  }
+
+  size_t ConsumersCount() const {
+    return consumers_.size();
+  }
+
+ private:
+  static constexpr uint64_t kClosedBit = uint64_t{1} << 63;
+  static constexpr size_t kCacheLine = 64;
+
+  struct alignas(kCacheLine) Consumer {
+    std::atomic<uint64_t> consumed = 0;
+    std::atomic<uint64_t> max_lag = 0;
+  };
+
+  // Returns the smallest consumed sequence, once it is at least min_consumed
+  uint64_t WaitForConsumers(uint64_t min_consumed) {
+    uint64_t slowest = std::numeric_limits<uint64_t>::max();
+    for (auto& consumer : consumers_) {
+      auto consumed = consumer.consumed.load(std::memory_order_acquire);
+      while (consumed < min_consumed) {
+        Wait(consumer.consumed, consumed);
+        consumed = consumer.consumed.load(std::memory_order_acquire);
+      }
+      slowest = std::min(slowest, consumed);
+    }
+    return slowest;
+  }
+
+  // Returns the published sequence, once it is past next or the ring is closed
+  uint64_t WaitForPublished(uint64_t next) {
+    auto published = published_.load(std::memory_order_acquire);
+    while (published == next) {
+      Wait(published_, published);
+      published = published_.load(std::memory_order_acquire);
+    }
+    return published;
+  }
+
+  void Wait(const std::atomic<uint64_t>& value, uint64_t old) {
+    switch (wait_strategy_) {
+      case WaitStrategy::BusySpin:
+        break;
+      case WaitStrategy::Yield:
+        std::this_thread::yield();
+        break;
+      case WaitStrategy::Block:
+        value.wait(old, std::memory_order_acquire);
+        break;
+    }
+  }
+
+  std::vector<T> slots_;
+  const size_t mask_;
+
+  // Written only by the producer
+  alignas(kCacheLine) uint64_t next_sequence_ = 0;
+  uint64_t gating_sequence_ = 0;  // lower bound of the slowest consumer's sequence
+  alignas(kCacheLine) std::atomic<uint64_t> published_ = 0;
+
+  std::vector<Consumer> consumers_;
+  const WaitStrategy wait_strategy_;
+};
+
+}  // namespace util
@@ -1,17 +1,29 @@
+#include <chrono>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <optional>
+#include <regex>
 
+#include <glob.h>
 #include <boost/program_options.hpp>
 
+#include "exception_helpers.hpp"
+#include "latency_stats.hpp"
+#include "message_broadcast.hpp"
+#include "perf_counters.hpp"
+#include "pcap_merger.hpp"
 #include "pcap_parser.hpp"
+#include "sharded_book_builder.hpp"
 #include "simba_parser.hpp"
+#include "streaming_pcap_parser.hpp"
+#include "trade_aggregator.hpp"
 
 namespace po = boost::program_options;
 
 namespace {
-  void InitOrderUpdateSink(
-      std::ofstream& sink,
-      simba::SimbaParser& simba_parser) {
+  void WriteOrderUpdateHeader(std::ofstream& sink) {
     sink
         << "md_entry_id" << ", "
         << "md_entry_px" << ", "
@@ -21,26 +33,33 @@ namespace {
         << "rpt_seq" << ", "
         << "md_update_action" << ", "
         << "md_entry_type" << "\n";
+  }
+
+  void WriteOrderUpdate(std::ofstream& sink, const simba::OrderUpdateMessage& msg) {
+    sink
+      << msg.md_entry_id << ", "
+      << simba::to_string(msg.md_entry_px) << ", "
+      << msg.md_entry_size << ", "
+      << msg.md_flags << ", "
+      << msg.security_id << ", "
+      << msg.rpt_seq << ", "
+      << simba::to_string(msg.md_update_action) << ", "
+      << msg.md_entry_type << "\n";
+  }
+
+  void InitOrderUpdateSink(
+      std::ofstream& sink,
+      simba::SimbaParser& simba_parser) {
+    WriteOrderUpdateHeader(sink);
 
     simba_parser.RegisterIncrementalCallback(
       simba::IncrementalMessage::OrderUpdate, 
       [&sink](const std::any& msg_holder) {
-        auto msg = std::any_cast<simba::OrderUpdateMessage>(msg_holder);
-        sink
-          << msg.md_entry_id << ", "
-          << simba::to_string(msg.md_entry_px) << ", "
-          << msg.md_entry_size << ", "
-          << msg.md_flags << ", "
-          << msg.security_id << ", "
-          << msg.rpt_seq << ", "
-          << simba::to_string(msg.md_update_action) << ", "
-          << msg.md_entry_type << "\n";
+        WriteOrderUpdate(sink, std::any_cast<simba::OrderUpdateMessage>(msg_holder));
     });
   }
 
-  void InitOrderExecutionSink(
-      std::ofstream& sink,
-      simba::SimbaParser& simba_parser) {
+  void WriteOrderExecutionHeader(std::ofstream& sink) {
     sink
         << "md_entry_id" << ", "
         << "md_entry_px" << ", "
@@ -53,29 +72,36 @@ namespace {
         << "rpt_seq" << ", "
         << "md_update_action" << ", "
         << "md_entry_type" << "\n";
+  }
+
+  void WriteOrderExecution(std::ofstream& sink, const simba::OrderExecutionMessage& msg) {
+    sink
+      << msg.md_entry_id << ", "
+      << simba::to_string(msg.md_entry_px) << ", "
+      << simba::to_string(msg.md_entry_size) << ", "
+      << simba::to_string(msg.last_px) << ", "
+      << msg.last_qty << ", "
+      << msg.trade_id << ", "
+      << msg.md_flags << ", "
+      << msg.security_id << ", "
+      << msg.rpt_seq << ", "
+      << simba::to_string(msg.md_update_action) << ", "
+      << msg.md_entry_type << "\n";
+  }
+
+  void InitOrderExecutionSink(
+      std::ofstream& sink,
+      simba::SimbaParser& simba_parser) {
+    WriteOrderExecutionHeader(sink);
 
     simba_parser.RegisterIncrementalCallback(
       simba::IncrementalMessage::OrderExecution, 
       [&sink](const std::any& msg_holder) {
-        auto msg = std::any_cast<simba::OrderExecutionMessage>(msg_holder);
-        sink
-          << msg.md_entry_id << ", "
-          << simba::to_string(msg.md_entry_px) << ", "
-          << simba::to_string(msg.md_entry_size) << ", "
-          << simba::to_string(msg.last_px) << ", "
-          << msg.last_qty << ", "
-          << msg.trade_id << ", "
-          << msg.md_flags << ", "
-          << msg.security_id << ", "
-          << msg.rpt_seq << ", "
-          << simba::to_string(msg.md_update_action) << ", "
-          << msg.md_entry_type << "\n";
+        WriteOrderExecution(sink, std::any_cast<simba::OrderExecutionMessage>(msg_holder));
     });
   }
 
-  void InitOrderBookSnapshotSink(
-      std::ofstream& sink,
-      simba::SimbaParser& simba_parser) {
+  void WriteOrderBookSnapshotHeader(std::ofstream& sink) {
     sink
         << "security_id" << ", "
         << "last_msg_seq_num_processed" << ", "
@@ -88,39 +114,370 @@ namespace {
         << "trade_id" << ", "
         << "md_flags_set" << ", "
         << "md_entry_type" << "\n";
+  }
+
+  void WriteOrderBookSnapshot(std::ofstream& sink, const simba::OrderBookSnapshotMessage& msg) {
+    for (size_t i = 0; i < msg.md_entries.size(); i++) {
+      if (i == 0) {
+        sink
+          << msg.header.security_id << ", "
+          << msg.header.last_msg_seq_num_processed << ", "
+          << msg.header.rpt_seq << ", "
+          << msg.header.exchange_trading_session_id << ", ";
+      } else {
+        sink << "~, ~, ~, ~, ";  // not to copy the same values
+      }
+      sink
+        << simba::to_string(msg.md_entries[i].md_entry_id) << ", "
+        << msg.md_entries[i].transact_time << ", "
+        << simba::to_string(msg.md_entries[i].md_entry_px) << ", "
+        << simba::to_string(msg.md_entries[i].md_entry_size) << ", "
+        << simba::to_string(msg.md_entries[i].trade_id) << ", "
+        << msg.md_entries[i].md_flags_set << ", "
+        << msg.md_entries[i].md_entry_type << "\n";
+    }
+  }
+
+  void InitOrderBookSnapshotSink(
+      std::ofstream& sink,
+      simba::SimbaParser& simba_parser) {
+    WriteOrderBookSnapshotHeader(sink);
 
     simba_parser.RegisterSnapshotCallback(
       simba::SnapshotMessage::OrderBookSnapshot, 
       [&sink](const std::any& msg_holder) {
-        auto msg = std::any_cast<simba::OrderBookSnapshotMessage>(msg_holder);
-        for (size_t i = 0; i < msg.md_entries.size(); i++) {
-          if (i == 0) {
-            sink
-              << msg.header.security_id << ", "
-              << msg.header.last_msg_seq_num_processed << ", "
-              << msg.header.rpt_seq << ", "
-              << msg.header.exchange_trading_session_id << ", ";
-          } else {
-            sink << "~, ~, ~, ~, ";  // not to copy the same values
-          }
-          sink
-            << simba::to_string(msg.md_entries[i].md_entry_id) << ", "
-            << msg.md_entries[i].transact_time << ", "
-            << simba::to_string(msg.md_entries[i].md_entry_px) << ", "
-            << simba::to_string(msg.md_entries[i].md_entry_size) << ", "
-            << simba::to_string(msg.md_entries[i].trade_id) << ", "
-            << msg.md_entries[i].md_flags_set << ", "
-            << msg.md_entries[i].md_entry_type << "\n";
+        WriteOrderBookSnapshot(sink, std::any_cast<simba::OrderBookSnapshotMessage>(msg_holder));
+    });
+  }
+
+  // Every sink reads the broadcast ring on its own thread
+  std::unique_ptr<simba::MessageBroadcast> InitBroadcastSinks(
+      std::ofstream& update_messages_sink,
+      std::ofstream& execution_messages_sink,
+      std::ofstream& book_snapshot_messages_sink,
+      simba::SimbaParser& simba_parser,
+      util::WaitStrategy wait_strategy) {
+    WriteOrderUpdateHeader(update_messages_sink);
+    WriteOrderExecutionHeader(execution_messages_sink);
+    WriteOrderBookSnapshotHeader(book_snapshot_messages_sink);
+
+    std::vector<simba::MessageBroadcast::Consumer> consumers = {
+      [&update_messages_sink](const simba::DecodedMessage& decoded) {
+        if (auto msg = std::get_if<simba::OrderUpdateMessage>(&decoded.message)) {
+          WriteOrderUpdate(update_messages_sink, *msg);
+        }
+      },
+      [&execution_messages_sink](const simba::DecodedMessage& decoded) {
+        if (auto msg = std::get_if<simba::OrderExecutionMessage>(&decoded.message)) {
+          WriteOrderExecution(execution_messages_sink, *msg);
         }
+      },
+      [&book_snapshot_messages_sink](const simba::DecodedMessage& decoded) {
+        if (auto msg = std::get_if<simba::OrderBookSnapshotMessage>(&decoded.message)) {
+          WriteOrderBookSnapshot(book_snapshot_messages_sink, *msg);
+        }
+      },
+    };
+    return std::make_unique<simba::MessageBroadcast>(simba_parser, std::move(consumers), wait_strategy);
+  }
+
+  void PrintConsumerStats(const std::vector<util::ConsumerStats>& stats) {
+    static const char* names[] = {"order update sink", "order execution sink", "book snapshot sink"};
+    for (size_t i = 0; i < stats.size(); i++) {
+      std::cout
+        << names[i] << ": "
+        << stats[i].consumed << " messages, "
+        << "lag " << stats[i].lag << ", "
+        << "max lag " << stats[i].max_lag << std::endl;
+    }
+  }
+
+  void InitBarSink(
+      std::ofstream& sink,
+      simba::SimbaParser& simba_parser,
+      simba::TradeAggregator& aggregator) {
+    sink
+        << "security_id" << ", "
+        << "start_time" << ", "
+        << "open" << ", "
+        << "high" << ", "
+        << "low" << ", "
+        << "close" << ", "
+        << "volume" << ", "
+        << "vwap" << ", "
+        << "trade_count" << "\n";
+
+    simba_parser.RegisterIncrementalCallback(
+      simba::IncrementalMessage::OrderExecution,
+      [&simba_parser, &aggregator](const std::any& msg_holder) {
+        auto msg = std::any_cast<simba::OrderExecutionMessage>(msg_holder);
+        aggregator.OnExecution(msg, simba_parser.CurrentPacketHeader().sending_time);
     });
   }
+
+  void WriteBar(std::ofstream& sink, const simba::Bar& bar) {
+    sink
+      << bar.security_id << ", "
+      << bar.start_time << ", "
+      << simba::to_string(bar.open) << ", "
+      << simba::to_string(bar.high) << ", "
+      << simba::to_string(bar.low) << ", "
+      << simba::to_string(bar.close) << ", "
+      << bar.volume << ", "
+      << std::fixed << std::setprecision(5) << simba::Vwap(bar) << ", "
+      << bar.trade_count << "\n";
+  }
+
+  void InitBookBuilder(
+      simba::SimbaParser& simba_parser,
+      simba::ShardedBookBuilder& book_builder) {
+    simba_parser.RegisterIncrementalCallback(
+      simba::IncrementalMessage::OrderUpdate,
+      [&book_builder](const std::any& msg_holder) {
+        book_builder.Route(std::any_cast<simba::OrderUpdateMessage>(msg_holder));
+    });
+    simba_parser.RegisterIncrementalCallback(
+      simba::IncrementalMessage::OrderExecution,
+      [&book_builder](const std::any& msg_holder) {
+        book_builder.Route(std::any_cast<simba::OrderExecutionMessage>(msg_holder));
+    });
+    simba_parser.RegisterSnapshotCallback(
+      simba::SnapshotMessage::OrderBookSnapshot,
+      [&book_builder](const std::any& msg_holder) {
+        book_builder.Route(std::any_cast<simba::OrderBookSnapshotMessage>(msg_holder));
+    });
+  }
+
+  void PrintShardStats(const std::vector<simba::ShardStats>& stats, double elapsed_seconds) {
+    for (size_t i = 0; i < stats.size(); i++) {
+      std::cout
+        << "shard " << i << ": "
+        << stats[i].instruments_count << " instruments, "
+        << stats[i].messages_count << " messages, "
+        << static_cast<uint64_t>(stats[i].messages_count / elapsed_seconds) << " messages/s, "
+        << "max queue depth " << stats[i].max_queue_depth << ", "
+        << "full queue waits " << stats[i].full_queue_waits << std::endl;
+    }
+  }
+
+  void PrintLatencyReport(const simba::LatencyStats& latency_stats) {
+    constexpr double kNanosecondsInMicrosecond = 1'000;
+    for (const auto& [channel_id, channel] : latency_stats.Channels()) {
+      const auto ip = channel_id.ip;
+      std::cout
+        << "channel " << (ip >> 24) << "." << ((ip >> 16) & 0xFF) << "."
+        << ((ip >> 8) & 0xFF) << "." << (ip & 0xFF) << ":" << channel_id.port << ": "
+        << channel.packets << " packets, " << channel.bytes << " bytes\n";
+
+      std::cout << std::fixed << std::setprecision(1) << "  latency us: ";
+      for (auto [name, percentile] : {std::pair{"p50", 50.0}, {"p90", 90.0}, {"p99", 99.0}, {"p99.9", 99.9}}) {
+        std::cout << name << " "
+          << channel.latency.Percentile(percentile) / kNanosecondsInMicrosecond << ", ";
+      }
+      std::cout
+        << "max " << channel.latency.Max() / kNanosecondsInMicrosecond << ", "
+        << "negative " << channel.negative_latency_count << "\n";
+
+      std::cout << "  inter-arrival us: ";
+      for (auto [name, percentile] : {std::pair{"p1", 1.0}, {"p50", 50.0}, {"p99", 99.0}}) {
+        std::cout << name << " "
+          << channel.inter_arrival.Percentile(percentile) / kNanosecondsInMicrosecond << ", ";
+      }
+      std::cout << "max " << channel.inter_arrival.Max() / kNanosecondsInMicrosecond << "\n";
+
+      simba::SecondStats busiest_second{};
+      uint64_t peak_bytes = 0;
+      uint64_t peak_millisecond_packets = 0;
+      for (const auto& second : channel.seconds) {
+        if (second.packets > busiest_second.packets) {
+          busiest_second = second;
+        }
+        peak_bytes = std::max(peak_bytes, second.bytes);
+        peak_millisecond_packets = std::max(peak_millisecond_packets, second.peak_millisecond_packets);
+      }
+      std::cout
+        << "  peak packets/s " << busiest_second.packets << " at " << busiest_second.second << ", "
+        << "peak bytes/s " << peak_bytes << ", "
+        << "peak 1ms rate " << peak_millisecond_packets << " packets" << std::endl;
+    }
+  }
+
+  // Returns false once the input is exhausted
+  bool FeedProfiledPacket(
+      pcap::PacketSource& parser,
+      simba::SimbaParser& simba_parser,
+      util::Profiler& profiler,
+      util::StageProfile& input_stage,
+      util::StageProfile& feed_packet_stage) {
+    pcap::PcapPacketView packet;
+    {
+      util::Profiler::Scope scope(profiler, input_stage);
+      if (!parser.HasNextPacket()) {
+        return false;
+      }
+      packet = parser.NextPacketView();
+    }
+    util::Profiler::Scope scope(profiler, feed_packet_stage);
+    simba_parser.FeedPcapPacket(packet);
+    return true;
+  }
+
+  void PrintCounters(const util::PerfCounters& counters, const util::PerfSample& totals, uint64_t calls) {
+    for (size_t i = 0; i < util::kPerfCountersCount; i++) {
+      const auto counter = static_cast<util::PerfCounter>(i);
+      if (counters.Available(counter)) {
+        std::cout << ", " << util::to_string(counter) << " " << static_cast<double>(totals[i]) / calls;
+      }
+    }
+    const auto cycles = totals[static_cast<size_t>(util::PerfCounter::Cycles)];
+    const auto instructions = totals[static_cast<size_t>(util::PerfCounter::Instructions)];
+    if (cycles != 0) {
+      std::cout << ", IPC " << static_cast<double>(instructions) / cycles;
+    }
+    std::cout << std::endl;
+  }
+
+  void PrintProfile(const util::Profiler& profiler) {
+    const auto& counters = profiler.Counters();
+    std::cout << "unavailable counters:";
+    for (size_t i = 0; i < util::kPerfCountersCount; i++) {
+      const auto counter = static_cast<util::PerfCounter>(i);
+      if (!counters.Available(counter)) {
+        std::cout << " " << util::to_string(counter);
+      }
+    }
+    std::cout << "\n" << std::fixed << std::setprecision(2);
+
+    // Template stages are measured per message, the others per packet. Stages
+    // exclude each other, so the whole pipeline is the sum of all of them
+    uint64_t messages_count = 0;
+    util::PerfSample pipeline_totals{};
+    for (const auto& [name, stage] : profiler.Stages()) {
+      std::cout << name << ": " << stage.calls << " calls";
+      PrintCounters(counters, stage.totals, std::max<uint64_t>(stage.calls, 1));
+      if (name.starts_with("template ") && name.ends_with(" decode")) {
+        messages_count += stage.calls;
+      }
+      for (size_t i = 0; i < util::kPerfCountersCount; i++) {
+        pipeline_totals[i] += stage.totals[i];
+      }
+    }
+    std::cout << "whole pipeline per message: " << messages_count << " messages";
+    PrintCounters(counters, pipeline_totals, std::max<uint64_t>(messages_count, 1));
+  }
+
+  std::optional<util::WaitStrategy> ParseWaitStrategy(const std::string& name) {
+    static const std::unordered_map<std::string, util::WaitStrategy> wait_strategies = {
+      {"busy-spin", util::WaitStrategy::BusySpin},
+      {"yield", util::WaitStrategy::Yield},
+      {"block", util::WaitStrategy::Block}
+    };
+    auto it = wait_strategies.find(name);
+    if (it == wait_strategies.end()) {
+      return std::nullopt;
+    }
+    return it->second;
+  }
+
+  std::vector<std::string> ExpandInputFiles(const std::vector<std::string>& patterns) {
+    std::vector<std::string> files;
+    for (const auto& pattern : patterns) {
+      glob_t matches;
+      // Patterns without matches are kept as is to report a missing file later
+      if (glob(pattern.c_str(), GLOB_NOCHECK, nullptr, &matches) == 0) {
+        files.insert(files.end(), matches.gl_pathv, matches.gl_pathv + matches.gl_pathc);
+      }
+      globfree(&matches);
+    }
+    return files;
+  }
+
+  std::unique_ptr<pcap::PacketSource> OpenInputFile(
+      const std::string& file,
+      const std::string& input_backend) {
+    try {
+      if (input_backend == "io_uring") {
+        return std::make_unique<pcap::StreamingPcapParser>(file, pcap::BlockReader::Backend::IoUring);
+      }
+      if (input_backend == "thread") {
+        return std::make_unique<pcap::StreamingPcapParser>(
+          file, pcap::BlockReader::Backend::ReadAheadThread);
+      }
+      return std::make_unique<pcap::PcapParser>(std::make_unique<std::ifstream>(file, std::ios::binary));
+    } catch (const std::runtime_error& exc) {
+      util::throw_runtime_exception("Failed to open ", file, ": ", exc.what());
+    }
+    return nullptr;
+  }
+
+  // Captures are rotated as Corvil-<channel>-<start ns>-<end ns>.pcap, so files
+  // of one channel never overlap in time and can be read one after another.
+  // Every other file is considered a channel of its own.
+  std::vector<std::vector<std::string>> GroupFilesByChannel(const std::vector<std::string>& files) {
+    static const std::regex rotated_file(R"((.*Corvil-\d+)-(\d+)-\d+\.pcap)");
+    std::map<std::string, std::vector<std::pair<uint64_t, std::string>>> channels;
+    for (const auto& file : files) {
+      std::smatch match;
+      if (std::regex_match(file, match, rotated_file)) {
+        channels[match[1]].emplace_back(std::stoull(match[2]), file);
+      } else {
+        channels[file].emplace_back(0, file);
+      }
+    }
+
+    std::vector<std::vector<std::string>> result;
+    for (auto& [channel, channel_files] : channels) {
+      std::sort(channel_files.begin(), channel_files.end());
+      auto& group = result.emplace_back();
+      for (const auto& [start_time, file] : channel_files) {
+        group.push_back(file);
+      }
+    }
+    return result;
+  }
+
+  std::unique_ptr<pcap::PacketSource> OpenInput(
+      const std::vector<std::string>& files,
+      const std::string& input_backend) {
+    if (files.size() == 1) {
+      return OpenInputFile(files.front(), input_backend);
+    }
+
+    std::vector<std::unique_ptr<pcap::PacketSource>> channels;
+    for (const auto& channel_files : GroupFilesByChannel(files)) {
+      std::vector<pcap::PcapChain::Opener> openers;
+      for (const auto& file : channel_files) {
+        openers.push_back([file, input_backend] { return OpenInputFile(file, input_backend); });
+      }
+      channels.push_back(std::make_unique<pcap::PcapChain>(std::move(openers)));
+    }
+    if (channels.size() == 1) {
+      return std::move(channels.front());
+    }
+    return std::make_unique<pcap::PcapMerger>(std::move(channels));
+  }
 }
 
 int main(int argc, char** argv) {
   po::options_description desc("Allowed options");
   desc.add_options()
       ("help", "produce help message")
-      ("input-file,i", po::value<std::string>()->required(), "Input pcap file")
+      ("input-file,i",
+      po::value<std::vector<std::string>>()->multitoken()->required(),
+      "Input pcap files or glob patterns; several captures are merged by packet timestamp, "
+      "rotated captures of one channel are read one after another")
+      ("input-backend",
+      po::value<std::string>()->default_value("stream"),
+      "stream: read input with std::ifstream; io_uring: read ahead with io_uring, "
+      "falling back to a read-ahead thread if it is unavailable; thread: read ahead on a thread")
+      ("output-mode",
+      po::value<std::string>()->default_value("csv"),
+      "csv: write decoded messages to csv files; bars: write only trade bars")
+      ("broadcast",
+      po::value<std::string>(),
+      "Run every csv sink on its own thread reading a broadcast ring of decoded messages "
+      "(csv output mode only); "
+      "the value is the wait strategy of idle threads: busy-spin, yield or block")
       ("output-order-update-file",
       po::value<std::string>()->default_value("update_messages.csv"),
       "output csv file to store decoded order update messages")
@@ -130,6 +487,23 @@ int main(int argc, char** argv) {
       ("output-book-snapshot-file",
       po::value<std::string>()->default_value("book_snapshot_messages.csv"),
       "output csv file to store decoded book snapshot messages")
+      ("output-bars-file",
+      po::value<std::string>()->default_value("bars.csv"),
+      "output csv file to store trade bars in bars output mode")
+      ("bar-interval-ms",
+      po::value<uint64_t>()->default_value(60'000),
+      "trade bar interval in milliseconds")
+      ("book-shards",
+      po::value<size_t>()->default_value(0),
+      "Number of threads building order books, sharded by instrument; 0 disables book building")
+      ("book-wait-strategy",
+      po::value<std::string>()->default_value("block"),
+      "How idle book building threads wait for messages: busy-spin, yield or block")
+      ("latency-report",
+      "Print exchange to capture latency and microburst statistics per channel")
+      ("profile",
+      "Measure perf_event counters per pipeline stage and message template; "
+      "costs two syscalls per measurement")
       ("limit-packets-number,n",
       po::value<size_t>(),
       "Number of packets to process; if negative, process all messages")
@@ -151,30 +525,136 @@ int main(int argc, char** argv) {
     return 1;
   }
 
-  pcap::PcapParser parser(std::make_unique<std::ifstream>(
-    vm["input-file"].as<std::string>(),
-    std::ios::binary));
+  const auto input_backend = vm["input-backend"].as<std::string>();
+  if (input_backend != "stream" && input_backend != "io_uring" && input_backend != "thread") {
+    std::cerr << "Unknown input backend: " << input_backend << std::endl;
+    return 1;
+  }
+
+  auto parser = OpenInput(
+    ExpandInputFiles(vm["input-file"].as<std::vector<std::string>>()),
+    input_backend);
+
+  const auto output_mode = vm["output-mode"].as<std::string>();
+  if (output_mode != "csv" && output_mode != "bars") {
+    std::cerr << "Unknown output mode: " << output_mode << std::endl;
+    return 1;
+  }
+
+  std::optional<util::WaitStrategy> broadcast_wait_strategy;
+  if (vm.count("broadcast")) {
+    broadcast_wait_strategy = ParseWaitStrategy(vm["broadcast"].as<std::string>());
+    if (!broadcast_wait_strategy) {
+      std::cerr << "Unknown wait strategy: " << vm["broadcast"].as<std::string>() << std::endl;
+      return 1;
+    }
+    if (output_mode != "csv") {
+      std::cerr << "Broadcast is supported only in csv output mode" << std::endl;
+      return 1;
+    }
+  }
+
+  std::ofstream update_messages_sink;
+  std::ofstream execution_messages_sink;
+  std::ofstream book_snapshot_messages_sink;
+  std::ofstream bars_sink;
+  simba::SimbaParser simba_parser(parser->LinkType());
+  simba::TradeAggregator trade_aggregator(
+    vm["bar-interval-ms"].as<uint64_t>() * 1'000'000,
+    [&bars_sink](const simba::Bar& bar) { WriteBar(bars_sink, bar); });
+
+  std::unique_ptr<simba::MessageBroadcast> broadcast;
+  if (output_mode == "csv") {
+    update_messages_sink.open(vm["output-order-update-file"].as<std::string>());
+    execution_messages_sink.open(vm["output-order-execution-file"].as<std::string>());
+    book_snapshot_messages_sink.open(vm["output-book-snapshot-file"].as<std::string>());
+    if (broadcast_wait_strategy) {
+      broadcast = InitBroadcastSinks(
+        update_messages_sink,
+        execution_messages_sink,
+        book_snapshot_messages_sink,
+        simba_parser,
+        *broadcast_wait_strategy);
+    } else {
+      InitOrderUpdateSink(update_messages_sink, simba_parser);
+      InitOrderExecutionSink(execution_messages_sink, simba_parser);
+      InitOrderBookSnapshotSink(book_snapshot_messages_sink, simba_parser);
+    }
+  } else {
+    bars_sink.open(vm["output-bars-file"].as<std::string>());
+    InitBarSink(bars_sink, simba_parser, trade_aggregator);
+  }
 
-  std::ofstream update_messages_sink(vm["output-order-update-file"].as<std::string>());
-  std::ofstream execution_messages_sink(vm["output-order-execution-file"].as<std::string>());
-  std::ofstream book_snapshot_messages_sink(vm["output-book-snapshot-file"].as<std::string>());
-  simba::SimbaParser simba_parser(parser.LinkType());
-  InitOrderUpdateSink(update_messages_sink, simba_parser);
-  InitOrderExecutionSink(execution_messages_sink, simba_parser);
-  InitOrderBookSnapshotSink(book_snapshot_messages_sink, simba_parser);
+  const auto book_shards = vm["book-shards"].as<size_t>();
+  std::unique_ptr<simba::ShardedBookBuilder> book_builder;
+  if (book_shards > 0) {
+    const auto book_wait_strategy = ParseWaitStrategy(vm["book-wait-strategy"].as<std::string>());
+    if (!book_wait_strategy) {
+      std::cerr << "Unknown wait strategy: " << vm["book-wait-strategy"].as<std::string>() << std::endl;
+      return 1;
+    }
+    book_builder = std::make_unique<simba::ShardedBookBuilder>(
+      book_shards, simba::ShardedBookBuilder::kDefaultQueueCapacity, *book_wait_strategy);
+    InitBookBuilder(simba_parser, *book_builder);
+  }
 
   size_t max_packet = std::numeric_limits<size_t>::max();
   if (vm.count("limit-packets-number")) {
     max_packet = vm["limit-packets-number"].as<size_t>();
   }
 
+  simba::LatencyStats latency_stats;
+  if (vm.count("latency-report")) {
+    simba_parser.RegisterPacketCallback([&latency_stats](const simba::PacketContext& packet) {
+      latency_stats.OnPacket(packet);
+    });
+  }
+
+  std::unique_ptr<util::Profiler> profiler;
+  util::StageProfile* input_stage = nullptr;
+  util::StageProfile* feed_packet_stage = nullptr;
+  if (vm.count("profile")) {
+    profiler = std::make_unique<util::Profiler>();
+    input_stage = &profiler->Stage("input");
+    feed_packet_stage = &profiler->Stage("FeedPcapPacket");
+    simba_parser.SetProfiler(profiler.get());
+  }
+
+  const auto start_time = std::chrono::steady_clock::now();
   size_t packets_num = 0;
-  for (; parser.HasNextPacket() && packets_num < max_packet; packets_num++) {
-    auto packet = parser.NextPacket();
-    simba_parser.FeedPcapPacket(packet);
+  if (profiler) {
+    for (; packets_num < max_packet; packets_num++) {
+      if (!FeedProfiledPacket(*parser, simba_parser, *profiler, *input_stage, *feed_packet_stage)) {
+        break;
+      }
+    }
+  } else {
+    for (; parser->HasNextPacket() && packets_num < max_packet; packets_num++) {
+      simba_parser.FeedPcapPacket(parser->NextPacketView());
+    }
+  }
+  trade_aggregator.Flush();
+  if (book_builder) {
+    book_builder->Finish();
   }
+  if (broadcast) {
+    broadcast->Finish();
+  }
+  const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_time;
 
   std::cout << "processed " << packets_num << " packets" << std::endl;
+  if (book_builder) {
+    PrintShardStats(book_builder->Stats(), elapsed.count());
+  }
+  if (broadcast) {
+    PrintConsumerStats(broadcast->Stats());
+  }
+  if (vm.count("latency-report")) {
+    PrintLatencyReport(latency_stats);
+  }
+  if (profiler) {
+    PrintProfile(*profiler);
+  }
     
   return 0;
 }
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "latency_stats.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace simba {
+
+namespace {
+
+constexpr uint64_t kNanosecondsInSecond = 1'000'000'000;
+constexpr uint64_t kNanosecondsInMillisecond = 1'000'000;
+
+}  // namespace
+
+void Histogram::Record(uint64_t value) {
+  counts_[BucketIndex(value)]++;
+  count_++;
+  max_ = std::max(max_, value);
+}
+
+uint64_t Histogram::Percentile(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  const auto rank = std::max<uint64_t>(1, static_cast<uint64_t>(percentile / 100 * count_ + 0.5));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts_.size(); i++) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      return std::min(BucketUpperBound(i), max_);
+    }
+  }
+  return max_;
+}
+
+// Values below kSubBuckets get a bucket each; above that every power of two
+// range is split into kSubBuckets equal buckets
+size_t Histogram::BucketIndex(uint64_t value) {
+  if (value < kSubBuckets) {
+    return value;
+  }
+  const int magnitude = std::bit_width(value) - 1;
+  const int shift = magnitude - kSubBucketBits;
+  const auto sub_bucket = (value >> shift) & (kSubBuckets - 1);
+  return (shift + 1) * kSubBuckets + sub_bucket;
+}
+
+uint64_t Histogram::BucketUpperBound(size_t index) {
+  if (index < kSubBuckets) {
+    return index;
+  }
+  const auto shift = index / kSubBuckets - 1;
+  const auto lower_bound = (kSubBuckets + index % kSubBuckets) << shift;
+  return lower_bound + ((uint64_t{1} << shift) - 1);
+}
+
+void LatencyStats::OnPacket(const PacketContext& packet) {
+  auto& channel = channels_[ChannelId{packet.destination_ip, packet.destination_port}];
+  const auto capture_time = packet.capture_time;
+
+  if (capture_time >= packet.header.sending_time) {
+    channel.latency.Record(capture_time - packet.header.sending_time);
+  } else {
+    channel.negative_latency_count++;
+  }
+
+  if (channel.packets != 0 && capture_time >= channel.last_capture_time) {
+    channel.inter_arrival.Record(capture_time - channel.last_capture_time);
+  }
+  channel.last_capture_time = capture_time;
+  channel.packets++;
+  channel.bytes += packet.size;
+
+  // Packets captured out of order are accounted in the latest second
+  const auto second = capture_time / kNanosecondsInSecond;
+  if (channel.seconds.empty() || channel.seconds.back().second < second) {
+    channel.seconds.push_back(SecondStats{.second = second});
+  }
+  auto& second_stats = channel.seconds.back();
+  second_stats.packets++;
+  second_stats.bytes += packet.size;
+
+  const auto millisecond = capture_time / kNanosecondsInMillisecond;
+  if (millisecond != channel.current_millisecond) {
+    channel.current_millisecond = millisecond;
+    channel.millisecond_packets = 0;
+  }
+  channel.millisecond_packets++;
+  second_stats.peak_millisecond_packets =
+    std::max(second_stats.peak_millisecond_packets, channel.millisecond_packets);
+}
+
+}  // namespace simba
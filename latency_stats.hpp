@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <compare>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "simba_parser.hpp"
+
+namespace simba {
+
+// Log-linear histogram which reports values with a relative error below 1/16
+class Histogram {
+ public:
+  void Record(uint64_t value);
+
+  // Upper bound of the bucket holding the given percentile, in [0, 100]
+  uint64_t Percentile(double percentile) const;
+
+  uint64_t Count() const { return count_; }
+  uint64_t Max() const { return max_; }
+
+ private:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr uint64_t kSubBuckets = 1 << kSubBucketBits;
+  static constexpr size_t kBucketsCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  static size_t BucketIndex(uint64_t value);
+  static uint64_t BucketUpperBound(size_t index);
+
+  std::array<uint64_t, kBucketsCount> counts_{};
+  uint64_t count_ = 0;
+  uint64_t max_ = 0;
+};
+
+struct SecondStats {
+  uint64_t second;  // capture time, seconds since epoch
+  uint64_t packets;
+  uint64_t bytes;
+  uint64_t peak_millisecond_packets;  // packets within the busiest millisecond
+};
+
+struct ChannelStats {
+  Histogram latency;        // capture time minus sending time, ns
+  Histogram inter_arrival;  // capture time since the previous packet, ns
+  uint64_t negative_latency_count = 0;  // sending time after capture time, i.e. clocks are off
+  uint64_t packets = 0;
+  uint64_t bytes = 0;
+  std::vector<SecondStats> seconds;
+
+  uint64_t last_capture_time = 0;
+  uint64_t current_millisecond = 0;
+  uint64_t millisecond_packets = 0;
+};
+
+struct ChannelId {
+  uint32_t ip;
+  uint16_t port;
+
+  auto operator<=>(const ChannelId&) const = default;
+};
+
+// Exchange to capture latency and burst statistics per multicast channel
+class LatencyStats {
+ public:
+  void OnPacket(const PacketContext& packet);
+
+  const std::map<ChannelId, ChannelStats>& Channels() const { return channels_; }
+
+ private:
+  std::map<ChannelId, ChannelStats> channels_;
+};
+
+}  // namespace simba
@@ -0,0 +1,63 @@
+#include "message_broadcast.hpp"
+
+namespace simba {
+
+MessageBroadcast::MessageBroadcast(
+    SimbaParser& simba_parser,
+    std::vector<Consumer> consumers,
+    util::WaitStrategy wait_strategy,
+    size_t capacity)
+    : ring_(capacity, consumers.size(), wait_strategy), consumers_(std::move(consumers)) {
+  simba_parser.RegisterIncrementalCallback(
+    IncrementalMessage::OrderUpdate,
+    [this, &simba_parser](const std::any& msg_holder) {
+      Publish<OrderUpdateMessage>(simba_parser, msg_holder);
+  });
+  simba_parser.RegisterIncrementalCallback(
+    IncrementalMessage::OrderExecution,
+    [this, &simba_parser](const std::any& msg_holder) {
+      Publish<OrderExecutionMessage>(simba_parser, msg_holder);
+  });
+  simba_parser.RegisterSnapshotCallback(
+    SnapshotMessage::OrderBookSnapshot,
+    [this, &simba_parser](const std::any& msg_holder) {
+      Publish<OrderBookSnapshotMessage>(simba_parser, msg_holder);
+  });
+
+  for (size_t i = 0; i < consumers_.size(); i++) {
+    threads_.emplace_back([this, i] {
+      ring_.Consume(i, consumers_[i]);
+    });
+  }
+}
+
+MessageBroadcast::~MessageBroadcast() {
+  Finish();
+}
+
+void MessageBroadcast::Finish() {
+  ring_.Close();
+  for (auto& thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+}
+
+std::vector<util::ConsumerStats> MessageBroadcast::Stats() const {
+  std::vector<util::ConsumerStats> result;
+  for (size_t i = 0; i < ring_.ConsumersCount(); i++) {
+    result.push_back(ring_.Stats(i));
+  }
+  return result;
+}
+
+template<class Message>
+void MessageBroadcast::Publish(const SimbaParser& simba_parser, const std::any& msg_holder) {
+  ring_.Publish([&](DecodedMessage& slot) {
+    slot.packet = simba_parser.CurrentPacket();
+    slot.message = *std::any_cast<Message>(&msg_holder);
+  });
+}
+
+}  // namespace simba
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <functional>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "broadcast_ring.hpp"
+#include "simba_parser.hpp"
+
+namespace simba {
+
+struct DecodedMessage {
+  PacketContext packet;
+  std::variant<OrderUpdateMessage, OrderExecutionMessage, OrderBookSnapshotMessage> message;
+};
+
+// Publishes messages decoded by the parser into a broadcast ring which is
+// read by every consumer on its own thread, so a slow consumer delays
+// neither the parser nor the other consumers.
+class MessageBroadcast {
+ public:
+  using Consumer = std::function<void(const DecodedMessage&)>;
+
+  MessageBroadcast(
+    SimbaParser& simba_parser,
+    std::vector<Consumer> consumers,
+    util::WaitStrategy wait_strategy = util::WaitStrategy::Yield,
+    size_t capacity = 1 << 16);
+  ~MessageBroadcast();
+
+  // Waits until consumers handle all published messages and stops them
+  void Finish();
+
+  std::vector<util::ConsumerStats> Stats() const;
+
+ private:
+  template<class Message>
+  void Publish(const SimbaParser& simba_parser, const std::any& msg_holder);
+
+  util::BroadcastRing<DecodedMessage> ring_;
+  std::vector<Consumer> consumers_;
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace simba
@@ -0,0 +1,167 @@
+#include "order_book.hpp"
+
+#include <limits>
+
+namespace simba {
+
+namespace {
+
+constexpr char kBidEntryType = '0';
+constexpr char kOfferEntryType = '1';
+constexpr int64_t kNullEntryId = std::numeric_limits<int64_t>::min();
+
+template<class Levels>
+std::optional<PriceLevel> TopLevel(const Levels& levels) {
+  if (levels.empty()) {
+    return std::nullopt;
+  }
+  return PriceLevel{Decimal5{levels.begin()->first}, levels.begin()->second};
+}
+
+}  // namespace
+
+void OrderBook::Apply(const OrderUpdateMessage& message) {
+  if (!Accept(message.rpt_seq)) {
+    return;
+  }
+
+  switch (message.md_update_action) {
+    case MdUpdateAction::New:
+    case MdUpdateAction::Change:
+      RemoveOrder(message.md_entry_id);
+      AddOrder(message.md_entry_id, Order{
+        .price = message.md_entry_px.mantissa,
+        .size = message.md_entry_size,
+        .type = message.md_entry_type
+      });
+      break;
+    case MdUpdateAction::Delete:
+      RemoveOrder(message.md_entry_id);
+      break;
+  }
+}
+
+void OrderBook::Apply(const OrderExecutionMessage& message) {
+  if (!Accept(message.rpt_seq)) {
+    return;
+  }
+
+  auto it = orders_.find(message.md_entry_id);
+  if (it == orders_.end()) {
+    return;
+  }
+  auto order = it->second;
+  RemoveOrder(message.md_entry_id);
+  // Partially filled order keeps its price and the remaining size
+  if (message.md_update_action == MdUpdateAction::Change &&
+      message.md_entry_size.value != std::numeric_limits<int64_t>::min()) {
+    order.size = message.md_entry_size.value;
+    AddOrder(message.md_entry_id, order);
+  }
+}
+
+void OrderBook::Apply(const OrderBookSnapshotMessage& message) {
+  const auto rpt_seq = message.header.rpt_seq;
+  if (rpt_seq_ != 0 && rpt_seq < rpt_seq_) {
+    return;
+  }
+  // A book kept in sync by incrementals is not rebuilt: an incremental may
+  // arrive between fragments of the snapshot, which would drop the rest of it.
+  // The only exception are further fragments of the snapshot just applied.
+  const bool snapshot_in_progress = rpt_seq == snapshot_rpt_seq_ && rpt_seq == rpt_seq_;
+  if (!needs_snapshot_ && !snapshot_in_progress) {
+    return;
+  }
+
+  // Snapshot of a book may span several messages with the same rpt_seq.
+  // Snapshot cycles repeat, and a book without activity keeps its rpt_seq,
+  // so entries may already be in the book and are replaced, not added.
+  if (rpt_seq != snapshot_rpt_seq_) {
+    Clear();
+  }
+  snapshot_rpt_seq_ = rpt_seq_ = rpt_seq;
+  needs_snapshot_ = false;
+
+  for (const auto& entry : message.md_entries) {
+    if (entry.md_entry_id.value == kNullEntryId) {
+      continue;
+    }
+    RemoveOrder(entry.md_entry_id.value);
+    AddOrder(entry.md_entry_id.value, Order{
+      .price = entry.md_entry_px.mantissa,
+      .size = entry.md_entry_size.value,
+      .type = entry.md_entry_type
+    });
+  }
+}
+
+std::optional<PriceLevel> OrderBook::BestBid() const {
+  return TopLevel(bids_);
+}
+
+std::optional<PriceLevel> OrderBook::BestOffer() const {
+  return TopLevel(offers_);
+}
+
+bool OrderBook::Accept(uint32_t rpt_seq) {
+  if (rpt_seq_ != 0 && rpt_seq <= rpt_seq_) {
+    return false;
+  }
+  if (rpt_seq_ != 0 && rpt_seq != rpt_seq_ + 1) {
+    gaps_++;
+    needs_snapshot_ = true;
+  } else if (rpt_seq_ == 0 && rpt_seq == 1) {
+    // The first update of the session, nothing was missed
+    needs_snapshot_ = false;
+  }
+  rpt_seq_ = rpt_seq;
+  return true;
+}
+
+void OrderBook::AddOrder(int64_t id, const Order& order) {
+  switch (order.type) {
+    case kBidEntryType:
+      bids_[order.price] += order.size;
+      break;
+    case kOfferEntryType:
+      offers_[order.price] += order.size;
+      break;
+    default:
+      // Not an order, e.g. an empty book marker
+      return;
+  }
+  orders_[id] = order;
+}
+
+void OrderBook::RemoveOrder(int64_t id) {
+  auto it = orders_.find(id);
+  if (it == orders_.end()) {
+    return;
+  }
+
+  auto remove_from_level = [&order = it->second](auto& levels) {
+    auto level = levels.find(order.price);
+    if (level != levels.end() && (level->second -= order.size) <= 0) {
+      levels.erase(level);
+    }
+  };
+  if (it->second.type == kBidEntryType) {
+    remove_from_level(bids_);
+  } else {
+    remove_from_level(offers_);
+  }
+  orders_.erase(it);
+}
+
+void OrderBook::Clear() {
+  orders_.clear();
+  bids_.clear();
+  offers_.clear();
+}
+
+const OrderBook* BookBuilder::FindBook(int32_t security_id) const {
+  auto it = books_.find(security_id);
+  return it == books_.end() ? nullptr : &it->second;
+}
+
+}  // namespace simba
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+#include "simba_parser.hpp"
+
+namespace simba {
+
+struct PriceLevel {
+  Decimal5 price;
+  int64_t size;
+};
+
+// Order book of a single instrument built from incremental and snapshot messages
+class OrderBook {
+ public:
+  void Apply(const OrderUpdateMessage& message);
+  void Apply(const OrderExecutionMessage& message);
+  void Apply(const OrderBookSnapshotMessage& message);
+
+  std::optional<PriceLevel> BestBid() const;
+  std::optional<PriceLevel> BestOffer() const;
+
+  size_t OrdersCount() const { return orders_.size(); }
+  uint32_t RptSeq() const { return rpt_seq_; }
+  size_t GapsCount() const { return gaps_; }
+
+ private:
+  struct Order {
+    int64_t price;
+    int64_t size;
+    char type;
+  };
+
+  // Returns false for messages already reflected in the book
+  bool Accept(uint32_t rpt_seq);
+  void AddOrder(int64_t id, const Order& order);
+  void RemoveOrder(int64_t id);
+  void Clear();
+
+  std::unordered_map<int64_t, Order> orders_;
+  std::map<int64_t, int64_t, std::greater<>> bids_;
+  std::map<int64_t, int64_t> offers_;
+  uint32_t rpt_seq_ = 0;
+  uint32_t snapshot_rpt_seq_ = 0;
+  // Set until the book is built from the start of the session or a snapshot,
+  // and again after a gap in rpt_seq
+  bool needs_snapshot_ = true;
+  size_t gaps_ = 0;
+};
+
+// Maintains order books of all instruments seen in the messages
+class BookBuilder {
+ public:
+  template<class Message>
+  void Apply(const Message& message) {
+    books_[SecurityId(message)].Apply(message);
+  }
+
+  const OrderBook* FindBook(int32_t security_id) const;
+
+  const std::unordered_map<int32_t, OrderBook>& Books() const { return books_; }
+
+ private:
+  static int32_t SecurityId(const OrderUpdateMessage& message) { return message.security_id; }
+  static int32_t SecurityId(const OrderExecutionMessage& message) { return message.security_id; }
+  static int32_t SecurityId(const OrderBookSnapshotMessage& message) { return message.header.security_id; }
+
+  std::unordered_map<int32_t, OrderBook> books_;
+};
+
+}  // namespace simba
@@ -0,0 +1,187 @@
+#include "pcap_merger.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "exception_helpers.hpp"
+
+namespace pcap {
+
+class PcapMerger::ReadAheadSource {
+ public:
+  ReadAheadSource(std::unique_ptr<PacketSource> source, size_t capacity)
+      : source_(std::move(source)), capacity_(capacity) {
+    reader_ = std::thread([this] { ReadLoop(); });
+  }
+
+  ~ReadAheadSource() {
+    {
+      std::lock_guard lock(mutex_);
+      stopped_ = true;
+    }
+    not_full_.notify_one();
+    reader_.join();
+  }
+
+  PcapLinkType LinkType() const {
+    return source_->LinkType();
+  }
+
+  // Blocks until the next packet is read; returns false once the source is exhausted
+  bool Pop(PcapPacket& packet) {
+    if (local_.empty()) {
+      std::unique_lock lock(mutex_);
+      not_empty_.wait(lock, [this] { return !shared_.empty() || finished_; });
+      if (shared_.empty() && error_) {
+        std::rethrow_exception(error_);
+      }
+      // Take the whole batch at once to touch the lock once per batch, not per packet
+      local_.swap(shared_);
+      lock.unlock();
+      not_full_.notify_one();
+      if (local_.empty()) {
+        return false;
+      }
+    }
+    packet = std::move(local_.front());
+    local_.pop_front();
+    return true;
+  }
+
+ private:
+  void ReadLoop() {
+    try {
+      while (source_->HasNextPacket()) {
+        auto packet = source_->NextPacket();
+        std::unique_lock lock(mutex_);
+        not_full_.wait(lock, [this] { return shared_.size() < capacity_ || stopped_; });
+        if (stopped_) {
+          return;
+        }
+        shared_.push_back(std::move(packet));
+        if (shared_.size() == 1) {
+          not_empty_.notify_one();
+        }
+      }
+    } catch (...) {
+      std::lock_guard lock(mutex_);
+      error_ = std::current_exception();
+    }
+    {
+      std::lock_guard lock(mutex_);
+      finished_ = true;
+    }
+    not_empty_.notify_one();
+  }
+
+  std::unique_ptr<PacketSource> source_;
+  const size_t capacity_;
+
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  std::deque<PcapPacket> shared_;
+  bool finished_ = false;
+  bool stopped_ = false;
+  std::exception_ptr error_;
+
+  // Accessed only by the consuming thread
+  std::deque<PcapPacket> local_;
+
+  std::thread reader_;
+};
+
+PcapChain::PcapChain(std::vector<Opener> openers) : openers_(std::move(openers)) {
+  if (openers_.empty()) {
+    util::throw_runtime_exception("No packet sources to chain");
+  }
+
+  current_ = openers_[next_opener_++]();
+  link_type_ = current_->LinkType();
+  SkipExhausted();
+}
+
+bool PcapChain::HasNextPacket() const {
+  return current_->HasNextPacket();
+}
+
+PcapPacket PcapChain::NextPacket() {
+  auto result = current_->NextPacket();
+  SkipExhausted();
+  return result;
+}
+
+PcapLinkType PcapChain::LinkType() const {
+  return link_type_;
+}
+
+void PcapChain::SkipExhausted() {
+  while (!current_->HasNextPacket() && next_opener_ < openers_.size()) {
+    // Release the previous capture before opening the next one
+    current_.reset();
+    current_ = openers_[next_opener_++]();
+    if (current_->LinkType() != link_type_) {
+      util::throw_runtime_exception(
+        "Link type mismatch of chained sources: ", static_cast<int>(current_->LinkType()),
+        " vs ", static_cast<int>(link_type_));
+    }
+  }
+}
+
+PcapMerger::PcapMerger(
+    std::vector<std::unique_ptr<PacketSource>> sources,
+    size_t read_ahead_packets) {
+  if (sources.empty()) {
+    util::throw_runtime_exception("No packet sources to merge");
+  }
+
+  link_type_ = sources.front()->LinkType();
+  for (const auto& source : sources) {
+    if (source->LinkType() != link_type_) {
+      util::throw_runtime_exception(
+        "Link type mismatch of merged sources: ", static_cast<int>(source->LinkType()),
+        " vs ", static_cast<int>(link_type_));
+    }
+  }
+
+  for (auto& source : sources) {
+    sources_.push_back(std::make_unique<ReadAheadSource>(std::move(source), read_ahead_packets));
+  }
+  heads_.resize(sources_.size());
+  for (size_t i = 0; i < sources_.size(); i++) {
+    PushHead(i);
+  }
+}
+
+PcapMerger::~PcapMerger() = default;
+
+bool PcapMerger::HasNextPacket() const {
+  return !heap_.empty();
+}
+
+PcapPacket PcapMerger::NextPacket() {
+  if (!HasNextPacket()) {
+    util::throw_runtime_exception("Packets stream exhausted");
+  }
+
+  const auto source_index = heap_.top().source_index;
+  heap_.pop();
+  auto result = std::move(heads_[source_index]);
+  PushHead(source_index);
+  return result;
+}
+
+PcapLinkType PcapMerger::LinkType() const {
+  return link_type_;
+}
+
+void PcapMerger::PushHead(size_t source_index) {
+  if (sources_[source_index]->Pop(heads_[source_index])) {
+    heap_.push(HeapEntry{heads_[source_index].timestamp_ns, source_index});
+  }
+}
+
+}  // namespace pcap
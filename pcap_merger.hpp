@@ -0,0 +1,73 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+#include "pcap_parser.hpp"
+
+namespace pcap {
+
+// Reads time-disjoint captures, e.g. rotated files of one channel, one after
+// another. Every capture is opened only once the previous one is exhausted.
+class PcapChain : public PacketSource {
+ public:
+  using Opener = std::function<std::unique_ptr<PacketSource>()>;
+
+  explicit PcapChain(std::vector<Opener> openers);
+
+  bool HasNextPacket() const override;
+
+  PcapPacket NextPacket() override;
+
+  PcapLinkType LinkType() const override;
+
+ private:
+  // Moves on to the next capture while the current one has no packets left
+  void SkipExhausted();
+
+  std::vector<Opener> openers_;
+  size_t next_opener_ = 0;
+  std::unique_ptr<PacketSource> current_;
+  PcapLinkType link_type_;
+};
+
+// Merges several packet sources into one stream ordered by capture time.
+// Every source is read ahead on its own thread, so that parsing of one
+// capture overlaps with reading of the others.
+class PcapMerger : public PacketSource {
+ public:
+  explicit PcapMerger(
+    std::vector<std::unique_ptr<PacketSource>> sources,
+    size_t read_ahead_packets = 4096);
+  ~PcapMerger() override;
+
+  bool HasNextPacket() const override;
+
+  PcapPacket NextPacket() override;
+
+  PcapLinkType LinkType() const override;
+
+ private:
+  class ReadAheadSource;
+
+  struct HeapEntry {
+    uint64_t timestamp_ns;
+    size_t source_index;
+
+    bool operator>(const HeapEntry& other) const {
+      return std::tie(timestamp_ns, source_index) > std::tie(other.timestamp_ns, other.source_index);
+    }
+  };
+
+  void PushHead(size_t source_index);
+
+  std::vector<std::unique_ptr<ReadAheadSource>> sources_;
+  std::vector<PcapPacket> heads_;
+  std::priority_queue<HeapEntry, std::vector<HeapEntry>, std::greater<>> heap_;
+  PcapLinkType link_type_;
+};
+
+}  // namespace pcap
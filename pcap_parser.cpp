@@ -15,31 +15,50 @@ constexpr uint16_t kExpectedMinorVersion = 4;
 
 }  // namespace
 
-PcapParser::PcapParser(std::unique_ptr<std::istream> input) : input_(std::move(input)) {
-  if (!*input_) {
-    util::throw_runtime_exception("Bad input stream");
-  }
-
+void CheckFileHeader(const FileHeader& file_header) {
   static_assert(sizeof(FileHeader) == 24);
 
-  input_->read(reinterpret_cast<char*>(&file_header_), sizeof(FileHeader));
-  if (file_header_.magic_number != kMagicNumberMicroseconds && 
-    file_header_.magic_number != kMagicNumberNanoseconds) {
+  if (file_header.magic_number != kMagicNumberMicroseconds && 
+    file_header.magic_number != kMagicNumberNanoseconds) {
     util::throw_runtime_exception(
-      "Not a PCAP file: magic number is ", file_header_.magic_number);
+      "Not a PCAP file: magic number is ", file_header.magic_number);
   }
 
-  if (file_header_.version_major != kExpectedMajorVersion) {
+  if (file_header.version_major != kExpectedMajorVersion) {
     util::throw_runtime_exception(
-      "Unsupported protocol major version: ", file_header_.version_major,
+      "Unsupported protocol major version: ", file_header.version_major,
       ", while supported is ", kExpectedMajorVersion);
   }
 
-  if (file_header_.version_minor > kExpectedMinorVersion) {
+  if (file_header.version_minor > kExpectedMinorVersion) {
     util::throw_runtime_exception(
-      "Unsupported protocol minor version: ", file_header_.version_minor,
+      "Unsupported protocol minor version: ", file_header.version_minor,
       ", while supported is at most ", kExpectedMinorVersion);
   }
+}
+
+uint64_t PacketTimestampNs(const FileHeader& file_header, const PacketHeader& packet_header) {
+  const uint64_t subsecond_multiplier =
+    file_header.magic_number == kMagicNumberNanoseconds ? 1 : 1'000;
+  return packet_header.ts_sec * 1'000'000'000ull + packet_header.ts_usec * subsecond_multiplier;
+}
+
+PcapPacketView PacketSource::NextPacketView() {
+  view_storage_ = NextPacket();
+  return PcapPacketView{
+    .header = view_storage_.header,
+    .timestamp_ns = view_storage_.timestamp_ns,
+    .data = view_storage_.data.data()
+  };
+}
+
+PcapParser::PcapParser(std::unique_ptr<std::istream> input) : input_(std::move(input)) {
+  if (!*input_) {
+    util::throw_runtime_exception("Bad input stream");
+  }
+
+  input_->read(reinterpret_cast<char*>(&file_header_), sizeof(FileHeader));
+  CheckFileHeader(file_header_);
 
   input_->read(reinterpret_cast<char*>(&next_packet_header_), sizeof(PacketHeader));
 }
@@ -58,7 +77,8 @@ PcapPacket PcapParser::NextPacket() {
 
   PcapPacket result{
     .header = next_packet_header_,
-    .data = data
+    .timestamp_ns = PacketTimestampNs(file_header_, next_packet_header_),
+    .data = std::move(data)
   };
 
   input_->read(reinterpret_cast<char*>(&next_packet_header_), sizeof(PacketHeader));
@@ -34,18 +34,48 @@ struct PacketHeader {
 
 struct PcapPacket {
   PacketHeader header;
+  uint64_t timestamp_ns;  // capture time regardless of the file timestamp resolution
   std::vector<uint8_t> data;
 };
 
-class PcapParser {
+// Packet which data is owned by the source it was read from
+struct PcapPacketView {
+  PacketHeader header;
+  uint64_t timestamp_ns;
+  const uint8_t* data;
+};
+
+// Throws if the file is not a supported pcap capture
+void CheckFileHeader(const FileHeader& file_header);
+
+uint64_t PacketTimestampNs(const FileHeader& file_header, const PacketHeader& packet_header);
+
+class PacketSource {
+ public:
+  virtual ~PacketSource() = default;
+
+  virtual bool HasNextPacket() const = 0;
+
+  virtual PcapPacket NextPacket() = 0;
+
+  // The view is valid until the next call to any method of the source
+  virtual PcapPacketView NextPacketView();
+
+  virtual PcapLinkType LinkType() const = 0;
+
+ private:
+  PcapPacket view_storage_;
+};
+
+class PcapParser : public PacketSource {
  public:
   explicit PcapParser(std::unique_ptr<std::istream> input);
 
-  bool HasNextPacket() const;
+  bool HasNextPacket() const override;
 
-  PcapPacket NextPacket();
+  PcapPacket NextPacket() override;
 
-  PcapLinkType LinkType() const;
+  PcapLinkType LinkType() const override;
  private:
   FileHeader file_header_;
   PacketHeader next_packet_header_;
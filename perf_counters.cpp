@@ -0,0 +1,132 @@
+#include "perf_counters.hpp"
+
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+
+#ifdef HAVE_PERF_EVENT
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "exception_helpers.hpp"
+
+namespace util {
+
+#ifdef HAVE_PERF_EVENT
+
+namespace {
+
+struct CounterConfig {
+  uint32_t type;
+  uint64_t config;
+};
+
+constexpr std::array<CounterConfig, kPerfCountersCount> kCounterConfigs = {{
+  {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+}};
+
+int OpenCounter(const CounterConfig& counter_config, int group_fd) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = counter_config.type;
+  attr.config = counter_config.config;
+  attr.read_format = PERF_FORMAT_GROUP;
+  attr.disabled = group_fd == -1;
+  // Unprivileged users are usually allowed to count user space only
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+}  // namespace
+
+#endif  // HAVE_PERF_EVENT
+
+const char* to_string(PerfCounter counter) {
+  switch (counter) {
+    case PerfCounter::TaskClock: return "task_clock_ns";
+    case PerfCounter::Cycles: return "cycles";
+    case PerfCounter::Instructions: return "instructions";
+    case PerfCounter::CacheMisses: return "cache_misses";
+    case PerfCounter::BranchMisses: return "branch_misses";
+  }
+  return "unknown";
+}
+
+PerfCounters::PerfCounters() {
+  positions_.fill(kNotOpened);
+  fds_.fill(kNotOpened);
+#ifdef HAVE_PERF_EVENT
+  for (size_t i = 0; i < kPerfCountersCount; i++) {
+    const int fd = OpenCounter(kCounterConfigs[i], group_fd_);
+    if (fd < 0) {
+      continue;
+    }
+    if (group_fd_ == kNotOpened) {
+      group_fd_ = fd;
+    }
+    fds_[i] = fd;
+    positions_[i] = static_cast<int>(opened_count_++);
+  }
+
+  if (group_fd_ != kNotOpened) {
+    ioctl(group_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+  for (auto fd : fds_) {
+    if (fd != kNotOpened) {
+      close(fd);
+    }
+  }
+}
+
+bool PerfCounters::Available(PerfCounter counter) const {
+  return positions_[static_cast<size_t>(counter)] != kNotOpened;
+}
+
+PerfSample PerfCounters::Read() const {
+  PerfSample result{};
+  if (group_fd_ == kNotOpened) {
+    return result;
+  }
+
+  // Layout of PERF_FORMAT_GROUP: number of counters followed by their values
+  std::array<uint64_t, kPerfCountersCount + 1> buffer;
+  const auto expected_size = static_cast<ssize_t>((opened_count_ + 1) * sizeof(uint64_t));
+  if (read(group_fd_, buffer.data(), expected_size) != expected_size) {
+    throw_runtime_exception("Failed to read perf counters: ", std::strerror(errno));
+  }
+  for (size_t i = 0; i < kPerfCountersCount; i++) {
+    if (positions_[i] != kNotOpened) {
+      result[i] = buffer[positions_[i] + 1];
+    }
+  }
+  return result;
+}
+
+Profiler::Profiler() {
+  // Average over back to back reads, a single one is too noisy to subtract
+  constexpr uint64_t kCalibrationReads = 1000;
+  const auto first = counters_.Read();
+  PerfSample last = first;
+  for (uint64_t i = 0; i < kCalibrationReads; i++) {
+    last = counters_.Read();
+  }
+  for (size_t i = 0; i < kPerfCountersCount; i++) {
+    read_overhead_[i] = (last[i] - first[i]) / kCalibrationReads;
+  }
+}
+
+}  // namespace util
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <string>
+
+namespace util {
+
+enum class PerfCounter {
+  TaskClock,  // nanoseconds, available even where hardware counters are not
+  Cycles,
+  Instructions,
+  CacheMisses,
+  BranchMisses,
+};
+
+constexpr size_t kPerfCountersCount = 5;
+
+const char* to_string(PerfCounter counter);
+
+using PerfSample = std::array<uint64_t, kPerfCountersCount>;
+
+// perf_event_open counters of the calling thread, read together as one group.
+// Counters the kernel or hardware does not provide are left unavailable, and
+// so are all of them when built without <linux/perf_event.h>.
+class PerfCounters {
+ public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  bool Available(PerfCounter counter) const;
+
+  // Unavailable counters read as zero
+  PerfSample Read() const;
+
+ private:
+  static constexpr int kNotOpened = -1;
+
+  int group_fd_ = kNotOpened;
+  size_t opened_count_ = 0;
+  // Position of every counter in the group read, kNotOpened if unavailable
+  std::array<int, kPerfCountersCount> positions_;
+  std::array<int, kPerfCountersCount> fds_;
+};
+
+struct StageProfile {
+  uint64_t calls = 0;
+  PerfSample totals{};
+};
+
+// Accumulates counter deltas per named pipeline stage. Must be used on the
+// thread which created it. Stages are exclusive: a scope opened inside another
+// one is subtracted from the outer stage, and so is the cost of the counter
+// reads themselves, so the totals of all stages add up to the measured work.
+class Profiler {
+ public:
+  Profiler();
+
+  Profiler(const Profiler&) = delete;
+  Profiler& operator=(const Profiler&) = delete;
+
+  // Scopes have to be closed in the reverse order of opening
+  class Scope {
+   public:
+    Scope(Profiler& profiler, StageProfile& stage)
+        : profiler_(profiler), stage_(stage), parent_(profiler.current_scope_) {
+      profiler_.current_scope_ = this;
+      start_ = profiler_.counters_.Read();
+    }
+
+    ~Scope() {
+      const auto end = profiler_.counters_.Read();
+      const auto& overhead = profiler_.read_overhead_;
+      for (size_t i = 0; i < kPerfCountersCount; i++) {
+        const auto elapsed = end[i] - start_[i];
+        const auto excluded = nested_[i] + overhead[i];
+        stage_.totals[i] += elapsed > excluded ? elapsed - excluded : 0;
+        if (parent_) {
+          parent_->nested_[i] += elapsed + overhead[i];
+        }
+      }
+      stage_.calls++;
+      profiler_.current_scope_ = parent_;
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    Profiler& profiler_;
+    StageProfile& stage_;
+    Scope* parent_;
+    // Counted by the nested scopes, including their counter reads
+    PerfSample nested_{};
+    PerfSample start_;
+  };
+
+  // The reference stays valid for the lifetime of the profiler
+  StageProfile& Stage(const std::string& name) { return stages_[name]; }
+
+  const std::map<std::string, StageProfile>& Stages() const { return stages_; }
+
+  const PerfCounters& Counters() const { return counters_; }
+
+  // Counted by a single read of the counters, subtracted from every scope
+  const PerfSample& ReadOverhead() const { return read_overhead_; }
+
+ private:
+  PerfCounters counters_;
+  PerfSample read_overhead_{};
+  Scope* current_scope_ = nullptr;
+  std::map<std::string, StageProfile> stages_;
+};
+
+}  // namespace util
@@ -0,0 +1,130 @@
+#include "sharded_book_builder.hpp"
+
+#include <algorithm>
+
+#include "exception_helpers.hpp"
+
+namespace simba {
+
+namespace {
+
+constexpr int kSpinsBeforeWait = 1024;
+
+int32_t SecurityId(const ShardedBookBuilder::BookEvent& event) {
+  return std::visit([](const auto& message) {
+    if constexpr (std::is_same_v<std::decay_t<decltype(message)>, OrderBookSnapshotMessage>) {
+      return message.header.security_id;
+    } else {
+      return message.security_id;
+    }
+  }, event);
+}
+
+}  // namespace
+
+void ShardedBookBuilder::Shard::Run() {
+  int idle_spins = 0;
+  while (true) {
+    // Loaded before the queue is checked, so a push after the check changes it
+    const auto last_wakeup = wakeups.load(std::memory_order_acquire);
+    if (auto event = queue.TryPop()) {
+      std::visit([this](const auto& message) { builder.Apply(message); }, *event);
+      messages_count.store(messages_count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      instruments_count.store(builder.Books().size(), std::memory_order_relaxed);
+      idle_spins = 0;
+      continue;
+    }
+    // Everything routed before stopping is visible once the flag is seen
+    if (stopping.load(std::memory_order_acquire) && queue.Size() == 0) {
+      return;
+    }
+    if (++idle_spins <= kSpinsBeforeWait) {
+      continue;
+    }
+    switch (wait_strategy) {
+      case util::WaitStrategy::BusySpin:
+        break;
+      case util::WaitStrategy::Yield:
+        std::this_thread::yield();
+        break;
+      case util::WaitStrategy::Block:
+        wakeups.wait(last_wakeup, std::memory_order_acquire);
+        break;
+    }
+  }
+}
+
+void ShardedBookBuilder::Shard::Wake() {
+  if (wait_strategy == util::WaitStrategy::Block) {
+    wakeups.store(wakeups.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    wakeups.notify_one();
+  }
+}
+
+ShardedBookBuilder::ShardedBookBuilder(
+    size_t shards_count,
+    size_t queue_capacity,
+    util::WaitStrategy wait_strategy) {
+  if (shards_count == 0) {
+    util::throw_runtime_exception("Book builder needs at least one shard");
+  }
+
+  for (size_t i = 0; i < shards_count; i++) {
+    shards_.push_back(std::make_unique<Shard>(queue_capacity, wait_strategy));
+  }
+  for (auto& shard : shards_) {
+    shard->worker = std::thread([shard = shard.get()] { shard->Run(); });
+  }
+}
+
+ShardedBookBuilder::~ShardedBookBuilder() {
+  Finish();
+}
+
+void ShardedBookBuilder::Route(BookEvent&& event) {
+  auto& shard = *shards_[ShardIndex(SecurityId(event))];
+  shard.max_queue_depth = std::max(shard.max_queue_depth, shard.queue.Size());
+  while (!shard.queue.TryPush(std::move(event))) {
+    shard.full_queue_waits++;
+    std::this_thread::yield();
+  }
+  shard.Wake();
+}
+
+void ShardedBookBuilder::Finish() {
+  for (auto& shard : shards_) {
+    shard->stopping.store(true, std::memory_order_release);
+    shard->Wake();
+  }
+  for (auto& shard : shards_) {
+    if (shard->worker.joinable()) {
+      shard->worker.join();
+    }
+  }
+}
+
+std::vector<ShardStats> ShardedBookBuilder::Stats() const {
+  std::vector<ShardStats> result;
+  for (const auto& shard : shards_) {
+    result.push_back(ShardStats{
+      .instruments_count = shard->instruments_count.load(std::memory_order_relaxed),
+      .messages_count = shard->messages_count.load(std::memory_order_relaxed),
+      .queue_depth = shard->queue.Size(),
+      .max_queue_depth = shard->max_queue_depth,
+      .full_queue_waits = shard->full_queue_waits
+    });
+  }
+  return result;
+}
+
+const OrderBook* ShardedBookBuilder::FindBook(int32_t security_id) const {
+  return shards_[ShardIndex(security_id)]->builder.FindBook(security_id);
+}
+
+size_t ShardedBookBuilder::ShardIndex(int32_t security_id) const {
+  // Fibonacci hashing spreads consecutive security ids over the shards
+  const uint32_t hash = static_cast<uint32_t>(security_id) * 2654435769u;
+  return (static_cast<uint64_t>(hash) * shards_.size()) >> 32;
+}
+
+}  // namespace simba
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include "order_book.hpp"
+#include "spsc_queue.hpp"
+#include "wait_strategy.hpp"
+
+namespace simba {
+
+struct ShardStats {
+  size_t instruments_count;
+  uint64_t messages_count;     // messages applied by the shard
+  size_t queue_depth;
+  size_t max_queue_depth;      // sampled on every routed message
+  uint64_t full_queue_waits;   // times the decoding thread waited for the shard
+};
+
+// Builds order books on several worker threads. Every instrument belongs to
+// one shard, and its messages reach the shard through a single queue, so
+// they are applied in the order of rpt_seq. Idle workers spin for a while
+// and then wait for messages as the wait strategy says.
+class ShardedBookBuilder {
+ public:
+  using BookEvent = std::variant<OrderUpdateMessage, OrderExecutionMessage, OrderBookSnapshotMessage>;
+
+  static constexpr size_t kDefaultQueueCapacity = 1 << 16;
+
+  explicit ShardedBookBuilder(
+    size_t shards_count,
+    size_t queue_capacity = kDefaultQueueCapacity,
+    util::WaitStrategy wait_strategy = util::WaitStrategy::Block);
+  ~ShardedBookBuilder();
+
+  // Must be called from a single thread, the same one that calls Stats
+  void Route(BookEvent&& event);
+
+  // Waits until all routed messages are applied and stops the workers
+  void Finish();
+
+  std::vector<ShardStats> Stats() const;
+
+  // Valid only after Finish
+  const OrderBook* FindBook(int32_t security_id) const;
+
+ private:
+  struct Shard {
+    Shard(size_t queue_capacity, util::WaitStrategy wait_strategy)
+        : queue(queue_capacity), wait_strategy(wait_strategy) {}
+
+    void Run();
+    // Called by the routing thread after a push or on stopping
+    void Wake();
+
+    util::SpscQueue<BookEvent> queue;
+    const util::WaitStrategy wait_strategy;
+    // Bumped on every wake up, the worker blocks on it with WaitStrategy::Block
+    std::atomic<uint64_t> wakeups = 0;
+    BookBuilder builder;
+    std::atomic<uint64_t> messages_count = 0;
+    std::atomic<size_t> instruments_count = 0;
+    std::atomic<bool> stopping = false;
+    size_t max_queue_depth = 0;
+    uint64_t full_queue_waits = 0;
+    std::thread worker;
+  };
+
+  size_t ShardIndex(int32_t security_id) const;
+
+  std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+}  // namespace simba
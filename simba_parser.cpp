@@ -3,8 +3,11 @@
 #include <arpa/inet.h>
 #include <boost/log/trivial.hpp>
 
+#include <optional>
+
 #include "exception_helpers.hpp"
 #include "pcap_parser.hpp"
+#include "perf_counters.hpp"
 
 namespace simba {
 
@@ -44,21 +47,42 @@ constexpr uint64_t MarketDataFlagSnapshotEnd = 0x4;
 constexpr uint64_t MarketDataFlagIncrementalPacket = 0x8;
 constexpr uint64_t MarketDataFlagPossDupFlag = 0x10;
 
+// The previous scope ends first, profiler scopes may not overlap
+void SwitchProfileStage(
+    std::optional<util::Profiler::Scope>& scope,
+    util::Profiler* profiler,
+    util::StageProfile* stage) {
+  scope.reset();
+  if (stage) {
+    scope.emplace(*profiler, *stage);
+  }
+}
+
 }  // namespace
 
 void SimbaParser::FeedPcapPacket(const pcap::PcapPacket& packet) {
+  FeedPcapPacket(pcap::PcapPacketView{
+    .header = packet.header,
+    .timestamp_ns = packet.timestamp_ns,
+    .data = packet.data.data()
+  });
+}
+
+void SimbaParser::FeedPcapPacket(const pcap::PcapPacketView& packet) {
   if (packet.header.captured_packet_length != packet.header.original_packet_length) {
     BOOST_LOG_TRIVIAL(debug) << "Truncated package";
   }
+  current_packet_.capture_time = packet.timestamp_ns;
+  current_packet_.size = packet.header.captured_packet_length;
   switch (link_type_) {
     case pcap::PcapLinkType::DLT_EN10MB: {
       EthernetHeader header;
-      memcpy(&header, packet.data.data(), sizeof(EthernetHeader));
+      memcpy(&header, packet.data, sizeof(EthernetHeader));
       header.ether_type = ntohs(header.ether_type);
       if (header.ether_type != kIpv4EtherType) {
         util::throw_runtime_exception("Unsupported ether type: ", std::hex, header.ether_type);
       }
-      ParseIpPacket(packet.data.data() + sizeof(EthernetHeader), header);
+      ParseIpPacket(packet.data + sizeof(EthernetHeader), header);
       break;
     }
     default:
@@ -78,6 +102,28 @@ void SimbaParser::RegisterSnapshotCallback(
   snapshot_callbacks_[msg_id].push_back(callback);
 }
 
+void SimbaParser::RegisterPacketCallback(const PacketCallback& callback) {
+  packet_callbacks_.push_back(callback);
+}
+
+void SimbaParser::SetProfiler(util::Profiler* profiler) {
+  profiler_ = profiler;
+  template_stages_.clear();
+}
+
+SimbaParser::TemplateStages SimbaParser::StagesOf(uint16_t template_id) {
+  if (!profiler_) {
+    return {};
+  }
+  auto [it, inserted] = template_stages_.try_emplace(template_id);
+  if (inserted) {
+    const auto name = "template " + std::to_string(template_id);
+    it->second.decode = &profiler_->Stage(name + " decode");
+    it->second.callbacks = &profiler_->Stage(name + " callbacks");
+  }
+  return it->second;
+}
+
 void SimbaParser::ParseIpPacket(const uint8_t* ip_packet_start, 
                                 const EthernetHeader& ether_header) {
   Ipv4Header ip_header;
@@ -91,6 +137,7 @@ void SimbaParser::ParseIpPacket(const uint8_t* ip_packet_start,
   auto underlying_packet_start = ip_packet_start + ip_header_size;
   switch (static_cast<IpProtocol>(ip_header.protocol)) {
     case IpProtocol::UDP: {
+      current_packet_.destination_ip = ntohl(ip_header.destination_ip);
       ParseUdpPacket(underlying_packet_start, ip_header);
       break;
     }
@@ -107,6 +154,7 @@ void SimbaParser::ParseUdpPacket(const uint8_t *udp_packet_start, const Ipv4Head
     udp_header.destination_port,
     udp_header.length, 
     udp_header.source_port);
+  current_packet_.destination_port = udp_header.destination_port;
   ParseSimbaPacket(udp_packet_start + sizeof(UdpHeader), udp_header);
 }
 
@@ -114,6 +162,10 @@ void SimbaParser::ParseSimbaPacket(const uint8_t *simba_packet_start, const UdpH
   MarketDataPacketHeader market_data_packet_header;
   memcpy(&market_data_packet_header, simba_packet_start, sizeof(MarketDataPacketHeader));
   assert(udp_header.length == market_data_packet_header.msg_size + sizeof(UdpHeader));
+  current_packet_.header = market_data_packet_header;
+  for (auto& callback : packet_callbacks_) {
+    callback(current_packet_);
+  }
 
   BOOST_LOG_TRIVIAL(debug) << "Received data packet #" << market_data_packet_header.msg_seq_num;
   auto underlying_packet = simba_packet_start + sizeof(MarketDataPacketHeader);
@@ -145,6 +197,10 @@ void SimbaParser::ParseIncrementalPacket(
     memcpy(&sbe_header, incremental_packet_start + offset, sizeof(SbeHeader));
     offset += sizeof(SbeHeader);
 
+    const auto stages = StagesOf(sbe_header.template_id);
+    std::optional<util::Profiler::Scope> profile_scope;
+    SwitchProfileStage(profile_scope, profiler_, stages.decode);
+
     switch (static_cast<IncrementalMessage>(sbe_header.template_id)) {
     case IncrementalMessage::OrderUpdate: {
       OrderUpdateMessage message;
@@ -153,6 +209,7 @@ void SimbaParser::ParseIncrementalPacket(
       }
       assert(sbe_header.block_length == sizeof(OrderUpdateMessage));
       memcpy(&message, incremental_packet_start + offset, sbe_header.block_length);
+      SwitchProfileStage(profile_scope, profiler_, stages.callbacks);
       for (auto& callback : incremental_callbacks_[IncrementalMessage::OrderUpdate]) {
         callback(message);
       }
@@ -165,6 +222,7 @@ void SimbaParser::ParseIncrementalPacket(
       }
       assert(sbe_header.block_length == sizeof(OrderExecutionMessage));
       memcpy(&message, incremental_packet_start + offset, sbe_header.block_length);
+      SwitchProfileStage(profile_scope, profiler_, stages.callbacks);
       for (auto& callback : incremental_callbacks_[IncrementalMessage::OrderExecution]) {
         callback(message);
       }
@@ -194,6 +252,10 @@ void SimbaParser::ParseSnapshotPacket(
     SbeHeader sbe_header;
     memcpy(&sbe_header, snapshot_packet_start, sizeof(SbeHeader));
     size_t offset = sizeof(SbeHeader);
+
+    const auto stages = StagesOf(sbe_header.template_id);
+    std::optional<util::Profiler::Scope> profile_scope;
+    SwitchProfileStage(profile_scope, profiler_, stages.decode);
     switch (static_cast<SnapshotMessage>(sbe_header.template_id)) {
       case SnapshotMessage::OrderBookSnapshot: {
         BOOST_LOG_TRIVIAL(debug) << "Received OrderBookSnapshot";
@@ -215,6 +277,7 @@ void SimbaParser::ParseSnapshotPacket(
           offset += message.header.no_md_entries.block_length;
         }
 
+        SwitchProfileStage(profile_scope, profiler_, stages.callbacks);
         for (auto& callback : snapshot_callbacks_[SnapshotMessage::OrderBookSnapshot]) {
           callback(message);
         }
@@ -13,10 +13,16 @@ static_assert(std::endian::native == std::endian::little,
               "This library is currently supported only for little-endian machines");
 
 namespace pcap {
-  class PcapPacket;
+  struct PcapPacket;
+  struct PcapPacketView;
   enum class PcapLinkType;
 }
 
+namespace util {
+  class Profiler;
+  struct StageProfile;
+}
+
 namespace simba {
 
 struct EthernetHeader {
@@ -136,15 +142,35 @@ struct OrderBookSnapshotMessage {
   std::vector<OrderBookSnapshotEntry> md_entries;
 };
 
+// Transport level details of a market data packet
+struct PacketContext {
+  uint64_t capture_time;  // nanoseconds since epoch, as recorded in the capture
+  uint32_t size;          // captured bytes, including all headers
+  uint32_t destination_ip;
+  uint16_t destination_port;
+  MarketDataPacketHeader header;
+};
+
 class SimbaParser {
  public:
   using MessageCallback = std::function<void(std::any)>;
+  using PacketCallback = std::function<void(const PacketContext&)>;
 
   explicit SimbaParser(pcap::PcapLinkType link_type) : link_type_(link_type) {}
   void FeedPcapPacket(const pcap::PcapPacket& packet);
+  void FeedPcapPacket(const pcap::PcapPacketView& packet);
 
   void RegisterIncrementalCallback(IncrementalMessage msg_id, const MessageCallback& callback);
   void RegisterSnapshotCallback(SnapshotMessage msg_id, const MessageCallback& callback);
+  // Invoked for every market data packet before callbacks of its messages
+  void RegisterPacketCallback(const PacketCallback& callback);
+
+  // Measures decoding of every message per template id; nullptr disables profiling
+  void SetProfiler(util::Profiler* profiler);
+
+  // Packet being parsed; valid while callbacks are invoked
+  const PacketContext& CurrentPacket() const { return current_packet_; }
+  const MarketDataPacketHeader& CurrentPacketHeader() const { return current_packet_.header; }
 
  private:
   void ParseIpPacket(const uint8_t* ip_packet_start, const EthernetHeader& ether_header);
@@ -157,9 +183,21 @@ class SimbaParser {
     const uint8_t* snapshot_packet_start,
     const MarketDataPacketHeader& header);
 
+  // Decoding and the registered callbacks are profiled as separate stages
+  struct TemplateStages {
+    util::StageProfile* decode = nullptr;
+    util::StageProfile* callbacks = nullptr;
+  };
+  // Both stages are null without a profiler
+  TemplateStages StagesOf(uint16_t template_id);
+
   std::unordered_map<IncrementalMessage, std::vector<MessageCallback>> incremental_callbacks_;
   std::unordered_map<SnapshotMessage, std::vector<MessageCallback>> snapshot_callbacks_;
+  std::vector<PacketCallback> packet_callbacks_;
   pcap::PcapLinkType link_type_;
+  PacketContext current_packet_{};
+  util::Profiler* profiler_ = nullptr;
+  std::unordered_map<uint16_t, TemplateStages> template_stages_;
 };
 
 }  // namespace simba
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace util {
+
+// Bounded lock-free queue for exactly one producer and one consumer thread
+template<class T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(size_t capacity)
+      : slots_(std::bit_ceil(capacity)), mask_(slots_.size() - 1) {}
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  // Called by the producer; returns false if the queue is full
+  bool TryPush(T&& value) {
+    const auto tail = tail_.load(std::memory_order_relaxed);
+    if (tail - cached_head_ == slots_.size()) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail - cached_head_ == slots_.size()) {
+        return false;
+      }
+    }
+    slots_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called by the consumer
+  std::optional<T> TryPop() {
+    const auto head = head_.load(std::memory_order_relaxed);
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head == cached_tail_) {
+        return std::nullopt;
+      }
+    }
+    std::optional<T> result(std::move(slots_[head & mask_]));
+    head_.store(head + 1, std::memory_order_release);
+    return result;
+  }
+
+  // Approximate when called concurrently with the producer or the consumer
+  size_t Size() const {
+    return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+  }
+
+  size_t Capacity() const {
+    return slots_.size();
+  }
+
+ private:
+  static constexpr size_t kCacheLine = 64;
+
+  std::vector<T> slots_;
+  const size_t mask_;
+
+  alignas(kCacheLine) std::atomic<size_t> head_ = 0;
+  size_t cached_tail_ = 0;  // consumer's view of tail_
+
+  alignas(kCacheLine) std::atomic<size_t> tail_ = 0;
+  size_t cached_head_ = 0;  // producer's view of head_
+};
+
+}  // namespace util
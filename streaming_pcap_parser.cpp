@@ -0,0 +1,107 @@
+#include "streaming_pcap_parser.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "exception_helpers.hpp"
+
+namespace pcap {
+
+StreamingPcapParser::StreamingPcapParser(
+    const std::string& path,
+    BlockReader::Backend backend,
+    size_t block_size,
+    size_t blocks_count) {
+  fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    util::throw_runtime_exception("Failed to open ", path, ": ", std::strerror(errno));
+  }
+
+  try {
+    reader_ = MakeBlockReader(fd_, block_size, blocks_count, backend);
+
+    auto file_header = Take(sizeof(FileHeader));
+    if (!file_header) {
+      util::throw_runtime_exception("Empty input: ", path);
+    }
+    memcpy(&file_header_, file_header, sizeof(FileHeader));
+    CheckFileHeader(file_header_);
+  } catch (...) {
+    reader_.reset();
+    close(fd_);
+    throw;
+  }
+}
+
+StreamingPcapParser::~StreamingPcapParser() {
+  reader_.reset();
+  close(fd_);
+}
+
+bool StreamingPcapParser::HasNextPacket() const {
+  return position_ < block_.size || NextBlock();
+}
+
+PcapPacket StreamingPcapParser::NextPacket() {
+  auto view = NextPacketView();
+  return PcapPacket{
+    .header = view.header,
+    .timestamp_ns = view.timestamp_ns,
+    .data = std::vector<uint8_t>(view.data, view.data + view.header.captured_packet_length)
+  };
+}
+
+PcapPacketView StreamingPcapParser::NextPacketView() {
+  auto header_data = Take(sizeof(PacketHeader));
+  if (!header_data) {
+    util::throw_runtime_exception("Packets stream exhausted");
+  }
+
+  PcapPacketView result;
+  memcpy(&result.header, header_data, sizeof(PacketHeader));
+  result.timestamp_ns = PacketTimestampNs(file_header_, result.header);
+  result.data = Take(result.header.captured_packet_length);
+  if (!result.data && result.header.captured_packet_length != 0) {
+    util::throw_runtime_exception("Truncated packet of ", result.header.captured_packet_length, " bytes");
+  }
+  return result;
+}
+
+PcapLinkType StreamingPcapParser::LinkType() const {
+  return static_cast<PcapLinkType>(file_header_.link_type);
+}
+
+const uint8_t* StreamingPcapParser::Take(size_t size) {
+  if (block_.data && block_.size - position_ >= size) {
+    auto result = block_.data + position_;
+    position_ += size;
+    return result;
+  }
+
+  spill_.clear();
+  while (spill_.size() < size) {
+    if (position_ == block_.size && !NextBlock()) {
+      if (spill_.empty()) {
+        return nullptr;
+      }
+      util::throw_runtime_exception("Input ends in the middle of a record");
+    }
+    const auto chunk = std::min(size - spill_.size(), block_.size - position_);
+    spill_.insert(spill_.end(), block_.data + position_, block_.data + position_ + chunk);
+    position_ += chunk;
+  }
+  return spill_.data();
+}
+
+bool StreamingPcapParser::NextBlock() const {
+  reader_->Release(block_);
+  block_ = reader_->Acquire();
+  position_ = 0;
+  return block_.size != 0;
+}
+
+}  // namespace pcap
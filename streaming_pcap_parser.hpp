@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "block_reader.hpp"
+#include "pcap_parser.hpp"
+
+namespace pcap {
+
+// Parses packets in place out of large buffers which are read ahead of the
+// parser, so reading overlaps with decoding. Unlike PcapParser it does not
+// need a seekable or mappable input, e.g. works for pipes.
+class StreamingPcapParser : public PacketSource {
+ public:
+  explicit StreamingPcapParser(
+    const std::string& path,
+    BlockReader::Backend backend = BlockReader::Backend::IoUring,
+    size_t block_size = 4 << 20,
+    size_t blocks_count = 8);
+  ~StreamingPcapParser() override;
+
+  bool HasNextPacket() const override;
+
+  PcapPacket NextPacket() override;
+
+  PcapPacketView NextPacketView() override;
+
+  PcapLinkType LinkType() const override;
+
+ private:
+  // Returns size contiguous bytes of the input, which are assembled in
+  // spill_ when they straddle blocks; nullptr if the input is over.
+  const uint8_t* Take(size_t size);
+
+  // Hands the current block back to the reader and waits for the next one
+  bool NextBlock() const;
+
+  int fd_;
+  std::unique_ptr<BlockReader> reader_;
+  // Advancing to the next block does not change the packets stream observed
+  mutable Block block_{};
+  mutable size_t position_ = 0;
+  std::vector<uint8_t> spill_;
+  FileHeader file_header_;
+};
+
+}  // namespace pcap
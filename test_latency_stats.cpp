@@ -0,0 +1,35 @@
+#include "latency_stats.hpp"
+#include "pcap_parser.hpp"
+#include "simba_parser.hpp"
+
+#include <fstream>
+#include <iostream>
+
+static constexpr char filename[] = "Corvil-13052-1636559040000000000-1636560600000000000.pcap";
+
+int main() {
+  pcap::PcapParser parser(std::make_unique<std::ifstream>(filename, std::ios::binary));
+
+  simba::SimbaParser simba_parser(parser.LinkType());
+  simba::LatencyStats latency_stats;
+  simba_parser.RegisterPacketCallback([&latency_stats](const simba::PacketContext& packet) {
+    latency_stats.OnPacket(packet);
+  });
+
+  int packets_num = 0;
+  while (parser.HasNextPacket()) {
+    simba_parser.FeedPcapPacket(parser.NextPacket());
+    packets_num++;
+  }
+
+  uint64_t channel_packets_num = 0;
+  for (const auto& [channel_id, channel] : latency_stats.Channels()) {
+    channel_packets_num += channel.packets;
+    std::cout << channel_id.port << ": median latency " << channel.latency.Percentile(50)
+      << " ns, " << channel.seconds.size() << " seconds" << std::endl;
+  }
+
+  std::cout << packets_num << " packets, " << channel_packets_num << " accounted" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,49 @@
+#include "message_broadcast.hpp"
+#include "pcap_parser.hpp"
+#include "simba_parser.hpp"
+
+#include <fstream>
+#include <iostream>
+
+static constexpr char filename[] = "Corvil-13052-1636559040000000000-1636560600000000000.pcap";
+static constexpr size_t kConsumersCount = 3;
+static constexpr size_t kCapacity = 1 << 16;
+static constexpr size_t kSmallCapacity = 16;
+
+int main() {
+  for (auto wait_strategy : {util::WaitStrategy::BusySpin, util::WaitStrategy::Yield, util::WaitStrategy::Block}) {
+    pcap::PcapParser parser(std::make_unique<std::ifstream>(filename, std::ios::binary));
+    simba::SimbaParser simba_parser(parser.LinkType());
+
+    std::vector<uint64_t> rpt_seq_sums(kConsumersCount);
+    std::vector<simba::MessageBroadcast::Consumer> consumers;
+    for (size_t i = 0; i < kConsumersCount; i++) {
+      consumers.push_back([&sum = rpt_seq_sums[i]](const simba::DecodedMessage& decoded) {
+        std::visit([&sum](const auto& msg) {
+          if constexpr (std::is_same_v<std::decay_t<decltype(msg)>, simba::OrderBookSnapshotMessage>) {
+            sum += msg.header.rpt_seq;
+          } else {
+            sum += msg.rpt_seq;
+          }
+        }, decoded.message);
+      });
+    }
+    // Small ring makes the parser wait for consumers. Busy spinning threads
+    // would hand off every slot at the cost of a timeslice on few cores.
+    const size_t capacity = wait_strategy == util::WaitStrategy::BusySpin ? kCapacity : kSmallCapacity;
+    simba::MessageBroadcast broadcast(simba_parser, std::move(consumers), wait_strategy, capacity);
+
+    while (parser.HasNextPacket()) {
+      simba_parser.FeedPcapPacket(parser.NextPacket());
+    }
+    broadcast.Finish();
+
+    for (size_t i = 0; i < kConsumersCount; i++) {
+      const auto stats = broadcast.Stats()[i];
+      std::cout << stats.consumed << " messages, rpt_seq sum " << rpt_seq_sums[i]
+        << ", max lag " << stats.max_lag << std::endl;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,34 @@
+#include "pcap_merger.hpp"
+
+#include <fstream>
+#include <iostream>
+
+static constexpr const char* filenames[] = {
+  "Corvil-13052-1636559040000000000-1636560600000000000.pcap",
+  "Corvil-13051-1636559040000000000-1636560600000000000.pcap",
+};
+
+int main() {
+  std::vector<std::unique_ptr<pcap::PacketSource>> sources;
+  for (auto filename : filenames) {
+    sources.push_back(std::make_unique<pcap::PcapParser>(
+      std::make_unique<std::ifstream>(filename, std::ios::binary)));
+  }
+  pcap::PcapMerger merger(std::move(sources));
+
+  int packets_num = 0;
+  int out_of_order_num = 0;
+  uint64_t last_timestamp = 0;
+  while (merger.HasNextPacket()) {
+    auto packet = merger.NextPacket();
+    if (packet.timestamp_ns < last_timestamp) {
+      out_of_order_num++;
+    }
+    last_timestamp = packet.timestamp_ns;
+    packets_num++;
+  }
+
+  std::cout << packets_num << " packets, " << out_of_order_num << " out of order" << std::endl;
+
+  return 0;
+}
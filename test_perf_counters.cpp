@@ -0,0 +1,43 @@
+#include "pcap_parser.hpp"
+#include "perf_counters.hpp"
+#include "simba_parser.hpp"
+
+#include <fstream>
+#include <iostream>
+
+static constexpr char filename[] = "Corvil-13052-1636559040000000000-1636560600000000000.pcap";
+
+int main() {
+  pcap::PcapParser parser(std::make_unique<std::ifstream>(filename, std::ios::binary));
+
+  util::Profiler profiler;
+  auto& packet_stage = profiler.Stage("packet");
+  simba::SimbaParser simba_parser(parser.LinkType());
+  simba_parser.SetProfiler(&profiler);
+
+  const auto task_clock = static_cast<size_t>(util::PerfCounter::TaskClock);
+  const auto start = profiler.Counters().Read();
+  while (parser.HasNextPacket()) {
+    auto packet = parser.NextPacket();
+    util::Profiler::Scope scope(profiler, packet_stage);
+    simba_parser.FeedPcapPacket(packet);
+  }
+  const auto measured = profiler.Counters().Read()[task_clock] - start[task_clock];
+
+  for (size_t i = 0; i < util::kPerfCountersCount; i++) {
+    const auto counter = static_cast<util::PerfCounter>(i);
+    std::cout << util::to_string(counter) << ": "
+      << (profiler.Counters().Available(counter) ? "available" : "unavailable") << std::endl;
+  }
+  // Stages exclude each other, so together they can not exceed the whole loop
+  uint64_t stages_sum = 0;
+  for (const auto& [name, stage] : profiler.Stages()) {
+    std::cout << name << ": " << stage.calls << " calls, " << stage.totals[task_clock] << " ns" << std::endl;
+    stages_sum += stage.totals[task_clock];
+  }
+  std::cout << "read overhead: " << profiler.ReadOverhead()[task_clock] << " ns" << std::endl;
+  std::cout << "stages sum: " << stages_sum << " ns of " << measured << " ns measured"
+    << (stages_sum <= measured ? "" : " (overlapping stages)") << std::endl;
+
+  return 0;
+}
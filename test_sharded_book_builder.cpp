@@ -0,0 +1,142 @@
+#include "pcap_parser.hpp"
+#include "sharded_book_builder.hpp"
+#include "simba_parser.hpp"
+
+#include <fstream>
+#include <iostream>
+
+static constexpr char filename[] = "Corvil-13052-1636559040000000000-1636560600000000000.pcap";
+static constexpr size_t kShardsCount = 4;
+
+bool SameLevel(const std::optional<simba::PriceLevel>& lhs, const std::optional<simba::PriceLevel>& rhs) {
+  if (!lhs || !rhs) {
+    return !lhs && !rhs;
+  }
+  return lhs->price.mantissa == rhs->price.mantissa && lhs->size == rhs->size;
+}
+
+// Snapshot cycles repeat with the same rpt_seq while the book is idle
+bool RepeatedSnapshotIsIdempotent() {
+  simba::OrderBookSnapshotMessage snapshot{};
+  snapshot.header.security_id = 1;
+  snapshot.header.rpt_seq = 10;
+  snapshot.md_entries.push_back(simba::OrderBookSnapshotEntry{
+    .md_entry_id = {42},
+    .md_entry_px = {100'00000},
+    .md_entry_size = {7},
+    .md_entry_type = '0'
+  });
+
+  simba::OrderBook book;
+  book.Apply(snapshot);
+  book.Apply(snapshot);
+  const auto best_bid = book.BestBid();
+  if (book.OrdersCount() != 1 || !best_bid || best_bid->size != 7) {
+    return false;
+  }
+
+  simba::OrderUpdateMessage delete_order{};
+  delete_order.md_entry_id = 42;
+  delete_order.security_id = 1;
+  delete_order.rpt_seq = 11;
+  delete_order.md_update_action = simba::MdUpdateAction::Delete;
+  book.Apply(delete_order);
+  return book.OrdersCount() == 0 && !book.BestBid();
+}
+
+simba::OrderUpdateMessage NewOrder(int64_t id, int64_t price, char type, uint32_t rpt_seq) {
+  simba::OrderUpdateMessage message{};
+  message.md_entry_id = id;
+  message.md_entry_px = {price};
+  message.md_entry_size = 1;
+  message.security_id = 1;
+  message.rpt_seq = rpt_seq;
+  message.md_update_action = simba::MdUpdateAction::New;
+  message.md_entry_type = type;
+  return message;
+}
+
+simba::OrderBookSnapshotMessage SnapshotFragment(int64_t id, int64_t price, char type, uint32_t rpt_seq) {
+  simba::OrderBookSnapshotMessage snapshot{};
+  snapshot.header.security_id = 1;
+  snapshot.header.rpt_seq = rpt_seq;
+  snapshot.md_entries.push_back(simba::OrderBookSnapshotEntry{
+    .md_entry_id = {id},
+    .md_entry_px = {price},
+    .md_entry_size = {1},
+    .md_entry_type = type
+  });
+  return snapshot;
+}
+
+// An incremental between fragments of a snapshot must not cost a book in sync its orders
+bool SnapshotDoesNotResetBookInSync() {
+  simba::OrderBook book;
+  book.Apply(NewOrder(1, 100'00000, '0', 1));
+  book.Apply(NewOrder(2, 101'00000, '1', 2));
+  book.Apply(SnapshotFragment(1, 100'00000, '0', 2));
+  book.Apply(NewOrder(3, 99'00000, '0', 3));
+  book.Apply(SnapshotFragment(2, 101'00000, '1', 2));
+
+  const auto best_offer = book.BestOffer();
+  return book.OrdersCount() == 3 && best_offer && best_offer->price.mantissa == 101'00000;
+}
+
+int main() {
+  std::cout << "repeated snapshot is idempotent: " << std::boolalpha
+    << RepeatedSnapshotIsIdempotent() << std::endl;
+  std::cout << "snapshot does not reset book in sync: "
+    << SnapshotDoesNotResetBookInSync() << std::endl;
+
+  pcap::PcapParser parser(std::make_unique<std::ifstream>(filename, std::ios::binary));
+
+  simba::SimbaParser simba_parser(parser.LinkType());
+  simba::BookBuilder book_builder;
+  simba::ShardedBookBuilder sharded_book_builder(kShardsCount);
+
+  simba_parser.RegisterIncrementalCallback(
+    simba::IncrementalMessage::OrderUpdate,
+    [&](const std::any& msg_holder) {
+      auto msg = std::any_cast<simba::OrderUpdateMessage>(msg_holder);
+      book_builder.Apply(msg);
+      sharded_book_builder.Route(msg);
+  });
+  simba_parser.RegisterIncrementalCallback(
+    simba::IncrementalMessage::OrderExecution,
+    [&](const std::any& msg_holder) {
+      auto msg = std::any_cast<simba::OrderExecutionMessage>(msg_holder);
+      book_builder.Apply(msg);
+      sharded_book_builder.Route(msg);
+  });
+  simba_parser.RegisterSnapshotCallback(
+    simba::SnapshotMessage::OrderBookSnapshot,
+    [&](const std::any& msg_holder) {
+      auto msg = std::any_cast<simba::OrderBookSnapshotMessage>(msg_holder);
+      book_builder.Apply(msg);
+      sharded_book_builder.Route(msg);
+  });
+
+  while (parser.HasNextPacket()) {
+    simba_parser.FeedPcapPacket(parser.NextPacket());
+  }
+  sharded_book_builder.Finish();
+
+  int mismatches_num = 0;
+  for (const auto& [security_id, book] : book_builder.Books()) {
+    auto sharded_book = sharded_book_builder.FindBook(security_id);
+    if (!sharded_book ||
+        sharded_book->OrdersCount() != book.OrdersCount() ||
+        !SameLevel(sharded_book->BestBid(), book.BestBid()) ||
+        !SameLevel(sharded_book->BestOffer(), book.BestOffer())) {
+      mismatches_num++;
+    }
+  }
+
+  std::cout << book_builder.Books().size() << " books, " << mismatches_num << " mismatches" << std::endl;
+  for (const auto& stats : sharded_book_builder.Stats()) {
+    std::cout << stats.instruments_count << " instruments, " << stats.messages_count << " messages, "
+      << "max queue depth " << stats.max_queue_depth << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,39 @@
+#include "pcap_parser.hpp"
+#include "streaming_pcap_parser.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+static constexpr char filename[] = "Corvil-13052-1636559040000000000-1636560600000000000.pcap";
+
+// Small blocks to make many packets straddle block boundaries
+static constexpr size_t kBlockSize = 1000;
+static constexpr size_t kBlocksCount = 3;
+
+int main() {
+  for (auto backend : {pcap::BlockReader::Backend::IoUring, pcap::BlockReader::Backend::ReadAheadThread}) {
+    pcap::PcapParser parser(std::make_unique<std::ifstream>(filename, std::ios::binary));
+    pcap::StreamingPcapParser streaming_parser(filename, backend, kBlockSize, kBlocksCount);
+
+    int packets_num = 0;
+    int mismatches_num = 0;
+    while (parser.HasNextPacket() && streaming_parser.HasNextPacket()) {
+      auto expected = parser.NextPacket();
+      auto packet = streaming_parser.NextPacketView();
+      if (packet.timestamp_ns != expected.timestamp_ns ||
+          packet.header.captured_packet_length != expected.data.size() ||
+          memcmp(packet.data, expected.data.data(), expected.data.size()) != 0) {
+        mismatches_num++;
+      }
+      packets_num++;
+    }
+    if (parser.HasNextPacket() || streaming_parser.HasNextPacket()) {
+      mismatches_num++;
+    }
+
+    std::cout << packets_num << " packets, " << mismatches_num << " mismatches" << std::endl;
+  }
+
+  return 0;
+}
@@ -0,0 +1,41 @@
+#include "pcap_parser.hpp"
+#include "simba_parser.hpp"
+#include "trade_aggregator.hpp"
+
+#include <fstream>
+#include <iostream>
+
+static constexpr char filename[] = "Corvil-13052-1636559040000000000-1636560600000000000.pcap";
+static constexpr uint64_t kMinuteNs = 60'000'000'000;
+
+int main() {
+  pcap::PcapParser parser(std::make_unique<std::ifstream>(filename, std::ios::binary));
+
+  simba::SimbaParser simba_parser(parser.LinkType());
+  int bars_num = 0;
+  int64_t volume = 0;
+  simba::TradeAggregator aggregator(kMinuteNs, [&](const simba::Bar& bar) {
+    bars_num++;
+    volume += bar.volume;
+  });
+
+  int64_t executions_volume = 0;
+  simba_parser.RegisterIncrementalCallback(
+    simba::IncrementalMessage::OrderExecution,
+    [&](const std::any& msg_holder) {
+      auto msg = std::any_cast<simba::OrderExecutionMessage>(msg_holder);
+      executions_volume += msg.last_qty;
+      aggregator.OnExecution(msg, simba_parser.CurrentPacketHeader().sending_time);
+  });
+
+  while (parser.HasNextPacket()) {
+    simba_parser.FeedPcapPacket(parser.NextPacket());
+  }
+  aggregator.Flush();
+
+  std::cout << bars_num << " bars, volume " << volume
+    << " (" << executions_volume << " executed, "
+    << aggregator.DuplicateTradesCount() << " duplicate trades)" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include "trade_aggregator.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include "exception_helpers.hpp"
+
+namespace simba {
+
+TradeAggregator::TradeAggregator(uint64_t interval_ns, const BarCallback& callback)
+    : interval_ns_(interval_ns), callback_(callback) {
+  if (interval_ns_ == 0) {
+    util::throw_runtime_exception("Bar interval must be positive");
+  }
+}
+
+void TradeAggregator::OnExecution(const OrderExecutionMessage& message, uint64_t sending_time) {
+  const auto index = InstrumentIndex(message.security_id);
+
+  // Trade ids are assigned by the exchange in increasing order, so the same
+  // trade reported once more (e.g. for each matched order) is never newer
+  // than the last one we have seen for the instrument.
+  if (message.trade_id <= last_trade_ids_[index]) {
+    duplicate_trades_++;
+    return;
+  }
+  last_trade_ids_[index] = message.trade_id;
+
+  const auto bucket = sending_time - sending_time % interval_ns_;
+  if (bucket > current_bucket_) {
+    CloseOpenBars();
+    current_bucket_ = bucket;
+  }
+  // Late packets from other channels are accounted in the current bar
+
+  auto& bar = open_bars_[index];
+  const auto price = message.last_px;
+  if (bar.trade_count == 0) {
+    bar.start_time = current_bucket_;
+    bar.open = bar.high = bar.low = price;
+    bar.volume = 0;
+    bar.turnover = 0;
+    active_instruments_.push_back(index);
+  }
+  bar.high.mantissa = std::max(bar.high.mantissa, price.mantissa);
+  bar.low.mantissa = std::min(bar.low.mantissa, price.mantissa);
+  bar.close = price;
+  bar.volume += message.last_qty;
+  bar.turnover += static_cast<double>(price.mantissa) * message.last_qty;
+  bar.trade_count++;
+}
+
+void TradeAggregator::Flush() {
+  CloseOpenBars();
+}
+
+size_t TradeAggregator::InstrumentIndex(int32_t security_id) {
+  auto [it, inserted] = instrument_index_.emplace(security_id, open_bars_.size());
+  if (inserted) {
+    open_bars_.push_back(Bar{.security_id = security_id, .trade_count = 0});
+    last_trade_ids_.push_back(std::numeric_limits<int64_t>::min());
+  }
+  return it->second;
+}
+
+void TradeAggregator::CloseOpenBars() {
+  std::sort(active_instruments_.begin(), active_instruments_.end(), [this](size_t lhs, size_t rhs) {
+    return open_bars_[lhs].security_id < open_bars_[rhs].security_id;
+  });
+  for (auto index : active_instruments_) {
+    callback_(open_bars_[index]);
+    open_bars_[index].trade_count = 0;
+  }
+  active_instruments_.clear();
+}
+
+}  // namespace simba
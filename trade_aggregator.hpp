@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include "simba_parser.hpp"
+
+namespace simba {
+
+struct Bar {
+  int32_t security_id;
+  uint64_t start_time;  // nanoseconds since epoch, aligned to the bar interval
+  Decimal5 open;
+  Decimal5 high;
+  Decimal5 low;
+  Decimal5 close;
+  int64_t volume;
+  double turnover;  // sum of price * quantity, in price units
+  uint32_t trade_count;
+};
+
+inline double Vwap(const Bar& bar) {
+  constexpr double exponent = 100'000;
+  return bar.volume == 0 ? 0 : bar.turnover / bar.volume / exponent;
+}
+
+// Builds per-instrument OHLCV bars out of OrderExecution messages.
+// Bars are bucketed by the packet sending time and emitted in time order
+// once the bucket is over (or on Flush).
+class TradeAggregator {
+ public:
+  using BarCallback = std::function<void(const Bar&)>;
+
+  TradeAggregator(uint64_t interval_ns, const BarCallback& callback);
+
+  void OnExecution(const OrderExecutionMessage& message, uint64_t sending_time);
+
+  // Emits all bars which are still open.
+  void Flush();
+
+  size_t DuplicateTradesCount() const { return duplicate_trades_; }
+
+ private:
+  size_t InstrumentIndex(int32_t security_id);
+  void CloseOpenBars();
+
+  uint64_t interval_ns_;
+  BarCallback callback_;
+  std::unordered_map<int32_t, size_t> instrument_index_;
+
+  // Indexed by instrument index; a bar with zero trades is not open
+  std::vector<Bar> open_bars_;
+  std::vector<int64_t> last_trade_ids_;
+  std::vector<size_t> active_instruments_;
+
+  uint64_t current_bucket_ = 0;
+  size_t duplicate_trades_ = 0;
+};
+
+}  // namespace simba
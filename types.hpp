@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cstdint>
+#include <iomanip>
+#include <limits>
 #include <string>
 #include <sstream>
 #include <unordered_map>
@@ -27,8 +29,15 @@ enum class MdUpdateAction : uint8_t {
 
 inline std::string to_string(Decimal5 decimal) {
   std::stringstream ss;
-  constexpr int64_t exponent = 100'000;
-  ss << (decimal.mantissa / exponent) << "." << decimal.mantissa % exponent;
+  constexpr uint64_t exponent = 100'000;
+  // Negated as unsigned, so the minimal mantissa does not overflow
+  const uint64_t magnitude = decimal.mantissa < 0
+    ? 0 - static_cast<uint64_t>(decimal.mantissa)
+    : static_cast<uint64_t>(decimal.mantissa);
+  if (decimal.mantissa < 0) {
+    ss << "-";
+  }
+  ss << (magnitude / exponent) << "." << std::setw(5) << std::setfill('0') << magnitude % exponent;
   return ss.str();
 }
 
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace util {
+
+// How a thread waits for work which is not there yet
+enum class WaitStrategy {
+  BusySpin,  // lowest latency, burns a core per waiting thread
+  Yield,     // spins, but lets other threads run
+  Block,     // sleeps until woken up, cheapest for idle threads
+};
+
+}  // namespace util